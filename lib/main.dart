@@ -13,10 +13,12 @@ import 'package:open_authenticator/i18n/translations.g.dart';
 import 'package:open_authenticator/model/app_links.dart';
 import 'package:open_authenticator/model/authentication/providers/email_link.dart';
 import 'package:open_authenticator/model/authentication/providers/provider.dart';
+import 'package:open_authenticator/model/codes_service.dart';
 import 'package:open_authenticator/model/crypto.dart';
 import 'package:open_authenticator/model/settings/show_intro.dart';
 import 'package:open_authenticator/model/settings/theme.dart';
 import 'package:open_authenticator/model/storage/online.dart';
+import 'package:open_authenticator/model/totp/decrypted.dart';
 import 'package:open_authenticator/model/totp/repository.dart';
 import 'package:open_authenticator/pages/contributor_plan_paywall/page.dart';
 import 'package:open_authenticator/pages/home/page.dart';
@@ -31,6 +33,7 @@ import 'package:open_authenticator/utils/platform.dart';
 import 'package:open_authenticator/utils/rate_my_app.dart';
 import 'package:open_authenticator/utils/result.dart';
 import 'package:open_authenticator/widgets/centered_circular_progress_indicator.dart';
+import 'package:open_authenticator/widgets/dialog/confirmation_dialog.dart';
 import 'package:open_authenticator/widgets/dialog/totp_limit.dart';
 import 'package:open_authenticator/widgets/unlock_challenge.dart';
 import 'package:open_authenticator/widgets/waiting_overlay.dart';
@@ -293,9 +296,14 @@ class _RouteWidgetState extends ConsumerState<_RouteWidget> {
             WidgetsBinding.instance.addPostFrameCallback((_) => handleTotpLink(uri));
             return;
           }
+          if (uri.scheme == 'otpauth-migration' && currentPlatform == Platform.linux) {
+            WidgetsBinding.instance.addPostFrameCallback((_) => handleTotpMigrationLink(uri));
+            return;
+          }
         },
         fireImmediately: true,
       );
+      ref.listenManual(codesServiceProvider, (previous, next) {});
       ref.listenManual(
         totpLimitProvider,
         (previous, next) async {
@@ -364,6 +372,66 @@ class _RouteWidgetState extends ConsumerState<_RouteWidget> {
     }
   }
 
+  /// Handles a TOTP migration link (eg. a Google Authenticator export), by adding all of its TOTPs once the user has confirmed.
+  Future<void> handleTotpMigrationLink(Uri migrationLink) async {
+    if (!mounted) {
+      return;
+    }
+    List<DecryptedTotp> totps;
+    try {
+      totps = await showWaitingOverlay(
+        context,
+        future: () async {
+          CryptoStore? cryptoStore = await ref.read(cryptoStoreProvider.future);
+          return await DecryptedTotp.fromUris(migrationLink.toString(), cryptoStore);
+        }(),
+      );
+    } on PlatformException catch (ex, stacktrace) {
+      // The runner failed to import the link (eg. it couldn't encrypt the secrets).
+      if (mounted) {
+        context.showSnackBarForResult(ResultError(exception: ex, stacktrace: stacktrace));
+      }
+      return;
+    }
+    if (!mounted) {
+      return;
+    }
+    if (totps.isEmpty) {
+      context.showSnackBarForResult(ResultError());
+      return;
+    }
+    bool confirmation = await ConfirmationDialog.ask(
+      context,
+      title: translations.totp.importConfirmationDialog.title,
+      message: translations.totp.importConfirmationDialog.message(n: totps.length),
+    );
+    if (!confirmation || !mounted) {
+      return;
+    }
+    bool willExceed = (await ref.read(totpLimitProvider.future)).willExceedIfAddMore(count: totps.length);
+    if (!mounted) {
+      return;
+    }
+    if (willExceed) {
+      await TotpLimitDialog.show(
+        context,
+        title: translations.totpLimit.addDialog.title,
+        message: translations.totpLimit.addDialog.message(
+          count: App.freeTotpsLimit.toString(),
+        ),
+        cancelButton: true,
+      );
+      return;
+    }
+    Result result = await showWaitingOverlay(
+      context,
+      future: ref.read(totpRepositoryProvider.notifier).addTotps(totps),
+    );
+    if (mounted) {
+      context.showSnackBarForResult(result);
+    }
+  }
+
   /// Handles TOTP limit exceeded.
   Future<void> handleTotpLimitExceeded() async {
     if (mounted) {
@@ -0,0 +1,31 @@
+import 'package:flutter/services.dart';
+import 'package:flutter_riverpod/flutter_riverpod.dart';
+import 'package:open_authenticator/model/app_unlock/method.dart';
+import 'package:open_authenticator/model/app_unlock/state.dart';
+import 'package:open_authenticator/model/crypto.dart';
+import 'package:open_authenticator/utils/platform.dart';
+
+/// The codes service provider.
+final codesServiceProvider = FutureProvider<void>((ref) async {
+  if (currentPlatform != Platform.linux) {
+    return;
+  }
+  AppLockState lockState = await ref.watch(appLockStateProvider.future);
+  CryptoStore? cryptoStore = await ref.watch(cryptoStoreProvider.future);
+  await CodesService._update(lockState == AppLockState.unlocked ? cryptoStore : null);
+});
+
+/// Allows the Linux runner to serve codes to other desktop tools (over D-Bus), while the app is unlocked.
+class CodesService {
+  /// The Linux runner method channel.
+  static const MethodChannel _methodChannel = MethodChannel('app.openauthenticator.runner');
+
+  /// Gives the key of the [cryptoStore] to the runner, or makes it forget it if `null`.
+  static Future<void> _update(CryptoStore? cryptoStore) async {
+    if (cryptoStore == null) {
+      await _methodChannel.invokeMethod('codesService.clearKey');
+    } else {
+      await _methodChannel.invokeMethod('codesService.setKey', await cryptoStore.key.exportRawKey());
+    }
+  }
+}
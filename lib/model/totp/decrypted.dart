@@ -1,12 +1,19 @@
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
 import 'package:hashlib/hashlib.dart' as hashlib;
 import 'package:hashlib_codecs/hashlib_codecs.dart';
 import 'package:open_authenticator/model/crypto.dart';
 import 'package:open_authenticator/model/totp/algorithm.dart';
 import 'package:open_authenticator/model/totp/totp.dart';
+import 'package:open_authenticator/utils/platform.dart';
 import 'package:uuid/uuid.dart';
 
 /// Represents a TOTP, in its decrypted state.
 class DecryptedTotp extends Totp {
+  /// The Linux runner method channel, that imports TOTPs natively.
+  static const MethodChannel _runnerMethodChannel = MethodChannel('app.openauthenticator.runner');
+
   /// Creates a new decrypted TOTP instance.
   const DecryptedTotp({
     required super.uuid,
@@ -128,6 +135,47 @@ class DecryptedTotp extends Totp {
     );
   }
 
+  /// Creates new TOTP instances from the `otpauth://` and `otpauth-migration://` URIs (separated by whitespaces) of the given [text].
+  /// On Linux, the runner reads and encrypts all of them in a single call.
+  static Future<List<DecryptedTotp>> fromUris(String text, CryptoStore? cryptoStore) async {
+    if (cryptoStore == null) {
+      return [];
+    }
+    if (currentPlatform != Platform.linux) {
+      List<DecryptedTotp> totps = [];
+      for (String part in text.split(RegExp(r'\s+'))) {
+        Uri? uri = Uri.tryParse(part);
+        DecryptedTotp? totp = uri == null ? null : await fromUri(uri, cryptoStore);
+        if (totp != null) {
+          totps.add(totp);
+        }
+      }
+      return totps;
+    }
+    Map<Object?, Object?>? result = await _runnerMethodChannel.invokeMethod<Map<Object?, Object?>>('totps.import', {
+      'text': text,
+      'key': await cryptoStore.key.exportRawKey(),
+    });
+    return [
+      for (Map<Object?, Object?> totp in (result?['totps'] as List<Object?>? ?? []).cast<Map<Object?, Object?>>())
+        DecryptedTotp(
+          uuid: const Uuid().v4(),
+          decryptedData: DecryptedData(
+            encryptedSecret: totp['encryptedSecret'] as Uint8List,
+            encryptedLabel: totp['encryptedLabel'] as Uint8List,
+            encryptedIssuer: totp['encryptedIssuer'] as Uint8List?,
+            encryptionSalt: cryptoStore.salt,
+            decryptedSecret: totp['secret'] as String,
+            decryptedLabel: totp['label'] as String,
+            decryptedIssuer: totp['issuer'] as String?,
+          ),
+          algorithm: totp['algorithm'] == null ? null : Algorithm.fromString(totp['algorithm'] as String),
+          digits: totp['digits'] as int?,
+          validity: totp['validity'] == null ? null : Duration(seconds: totp['validity'] as int),
+        ),
+    ];
+  }
+
   /// Returns the URI associated to this TOTP instance.
   Uri get uri => toUri(
     secret: secret,
@@ -107,6 +107,32 @@ class TotpRepository extends AsyncNotifier<TotpList> {
     }
   }
 
+  /// Adds the given [totps].
+  Future<Result<List<Totp>>> addTotps(List<Totp> totps) async {
+    try {
+      if (totps.isEmpty) {
+        return const ResultSuccess();
+      }
+      TotpList totpList = await future;
+      await totpList.waitBeforeNextOperation();
+      Storage storage = await ref.read(storageProvider.future);
+      await storage.addTotps(totps);
+      await ref.read(totpImageCacheManagerProvider.notifier).fillCache(totps: totps);
+      state = AsyncData(
+        TotpList._fromListAndStorage(
+          list: _mergeToCurrentList(totpList, totps: totps),
+          storage: storage,
+        ),
+      );
+      return const ResultSuccess();
+    } catch (ex, stacktrace) {
+      return ResultError(
+        exception: ex,
+        stacktrace: stacktrace,
+      );
+    }
+  }
+
   /// Clears all TOTPs and then adds the [totps].
   Future<Result<List<Totp>>> replaceBy(List<Totp> totps) async {
     try {
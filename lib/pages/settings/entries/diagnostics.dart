@@ -0,0 +1,199 @@
+import 'dart:convert';
+
+import 'package:flutter/material.dart';
+import 'package:flutter/services.dart';
+import 'package:open_authenticator/i18n/translations.g.dart';
+import 'package:open_authenticator/utils/frame_timing_report.dart';
+import 'package:open_authenticator/utils/native_memory.dart';
+import 'package:open_authenticator/utils/native_metrics.dart';
+import 'package:open_authenticator/utils/native_trace.dart';
+import 'package:open_authenticator/utils/platform.dart';
+import 'package:open_authenticator/utils/startup_trace.dart';
+import 'package:open_authenticator/widgets/snackbar_icon.dart';
+import 'package:open_authenticator/widgets/waiting_overlay.dart';
+
+/// Allows to copy the metrics recorded by the native runner.
+class NativeMetricsSettingsEntryWidget extends StatelessWidget {
+  /// Creates a new native metrics settings entry widget instance.
+  const NativeMetricsSettingsEntryWidget({
+    super.key,
+  });
+
+  @override
+  Widget build(BuildContext context) {
+    if (currentPlatform != Platform.linux && currentPlatform != Platform.windows) {
+      return const SizedBox.shrink();
+    }
+    return ListTile(
+      leading: const Icon(Icons.analytics),
+      title: Text(translations.settings.diagnostics.nativeMetrics.title),
+      subtitle: Text(translations.settings.diagnostics.nativeMetrics.subtitle),
+      onTap: () async {
+        Map<String, dynamic>? snapshot = await showWaitingOverlay(
+          context,
+          future: NativeMetrics.snapshot(),
+        );
+        if (context.mounted) {
+          await _copyReport(context, snapshot == null ? null : const JsonEncoder.withIndent('  ').convert(snapshot));
+        }
+      },
+    );
+  }
+}
+
+/// Allows to record the spans of the native runner, and to copy them as a Chrome trace.
+class NativeTraceSettingsEntryWidget extends StatefulWidget {
+  /// Creates a new native trace settings entry widget instance.
+  const NativeTraceSettingsEntryWidget({
+    super.key,
+  });
+
+  @override
+  State<StatefulWidget> createState() => _NativeTraceSettingsEntryWidgetState();
+}
+
+/// The native trace settings entry widget state.
+class _NativeTraceSettingsEntryWidgetState extends State<NativeTraceSettingsEntryWidget> {
+  /// Whether spans are being recorded. Kept across pages, so that the app can be used meanwhile.
+  static bool _recording = false;
+
+  @override
+  Widget build(BuildContext context) {
+    if (!NativeTrace.isSupported) {
+      return const SizedBox.shrink();
+    }
+    return ListTile(
+      leading: Icon(_recording ? Icons.stop : Icons.timeline),
+      title: Text(_recording ? translations.settings.diagnostics.nativeTrace.stop.title : translations.settings.diagnostics.nativeTrace.start.title),
+      subtitle: Text(_recording ? translations.settings.diagnostics.nativeTrace.stop.subtitle : translations.settings.diagnostics.nativeTrace.start.subtitle),
+      onTap: () async {
+        if (!_recording) {
+          await NativeTrace.clear();
+          await NativeTrace.setEnabled(true);
+          _recording = true;
+          if (mounted) {
+            setState(() {});
+          }
+          return;
+        }
+        await NativeTrace.setEnabled(false);
+        _recording = false;
+        String? trace = await NativeTrace.export();
+        if (mounted) {
+          setState(() {});
+          await _copyReport(context, trace);
+        }
+      },
+    );
+  }
+}
+
+/// Allows to record the frame timings, and to copy them as a jank report.
+class FrameTimingReportSettingsEntryWidget extends StatefulWidget {
+  /// Creates a new frame timing report settings entry widget instance.
+  const FrameTimingReportSettingsEntryWidget({
+    super.key,
+  });
+
+  @override
+  State<StatefulWidget> createState() => _FrameTimingReportSettingsEntryWidgetState();
+}
+
+/// The frame timing report settings entry widget state.
+class _FrameTimingReportSettingsEntryWidgetState extends State<FrameTimingReportSettingsEntryWidget> {
+  /// The report being recorded, if any. Kept across pages, so that the app can be used meanwhile.
+  static FrameTimingReport? _report;
+
+  @override
+  Widget build(BuildContext context) => ListTile(
+    leading: Icon(_report == null ? Icons.speed : Icons.stop),
+    title: Text(_report == null ? translations.settings.diagnostics.frameTimingReport.start.title : translations.settings.diagnostics.frameTimingReport.stop.title),
+    subtitle: Text(
+      _report == null ? translations.settings.diagnostics.frameTimingReport.start.subtitle : translations.settings.diagnostics.frameTimingReport.stop.subtitle,
+    ),
+    onTap: () async {
+      FrameTimingReport? report = _report;
+      if (report == null) {
+        setState(() => _report = FrameTimingReport()..start());
+        return;
+      }
+      report.stop();
+      _report = null;
+      String json = await report.build();
+      if (mounted) {
+        setState(() {});
+        await _copyReport(context, json);
+      }
+    },
+  );
+}
+
+/// Allows to copy the memory footprint reported by the native runner.
+class NativeMemorySettingsEntryWidget extends StatelessWidget {
+  /// Creates a new native memory settings entry widget instance.
+  const NativeMemorySettingsEntryWidget({
+    super.key,
+  });
+
+  @override
+  Widget build(BuildContext context) {
+    if (currentPlatform != Platform.linux) {
+      return const SizedBox.shrink();
+    }
+    return ListTile(
+      leading: const Icon(Icons.memory),
+      title: Text(translations.settings.diagnostics.nativeMemory.title),
+      subtitle: Text(translations.settings.diagnostics.nativeMemory.subtitle),
+      onTap: () async {
+        Map<String, dynamic>? report = await showWaitingOverlay(
+          context,
+          future: NativeMemory.report(),
+        );
+        if (context.mounted) {
+          await _copyReport(context, report == null ? null : const JsonEncoder.withIndent('  ').convert(report));
+        }
+      },
+    );
+  }
+}
+
+/// Allows to copy the startup phases recorded by the native runner.
+class StartupTraceSettingsEntryWidget extends StatelessWidget {
+  /// Creates a new startup trace settings entry widget instance.
+  const StartupTraceSettingsEntryWidget({
+    super.key,
+  });
+
+  @override
+  Widget build(BuildContext context) {
+    if (currentPlatform != Platform.linux) {
+      return const SizedBox.shrink();
+    }
+    return ListTile(
+      leading: const Icon(Icons.rocket_launch),
+      title: Text(translations.settings.diagnostics.startupTrace.title),
+      subtitle: Text(translations.settings.diagnostics.startupTrace.subtitle),
+      onTap: () async {
+        Map<String, dynamic>? trace = await showWaitingOverlay(
+          context,
+          future: StartupTrace.read(),
+        );
+        if (context.mounted) {
+          await _copyReport(context, trace == null ? null : const JsonEncoder.withIndent('  ').convert(trace));
+        }
+      },
+    );
+  }
+}
+
+/// Copies the given [report] to the clipboard.
+Future<void> _copyReport(BuildContext context, String? report) async {
+  if (report == null) {
+    SnackBarIcon.showErrorSnackBar(context, text: translations.settings.diagnostics.unsupported);
+    return;
+  }
+  await Clipboard.setData(ClipboardData(text: report));
+  if (context.mounted) {
+    SnackBarIcon.showSuccessSnackBar(context, text: translations.settings.diagnostics.copied);
+  }
+}
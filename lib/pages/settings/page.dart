@@ -14,6 +14,7 @@ import 'package:open_authenticator/pages/settings/entries/confirm_email.dart';
 import 'package:open_authenticator/pages/settings/entries/contributor_plan.dart';
 import 'package:open_authenticator/pages/settings/entries/contributor_plan_state.dart';
 import 'package:open_authenticator/pages/settings/entries/delete_account.dart';
+import 'package:open_authenticator/pages/settings/entries/diagnostics.dart';
 import 'package:open_authenticator/pages/settings/entries/display_copy_button.dart';
 import 'package:open_authenticator/pages/settings/entries/display_search_button.dart';
 import 'package:open_authenticator/pages/settings/entries/enable_local_auth.dart';
@@ -83,12 +84,20 @@ class SettingsPage extends ConsumerWidget {
           _SettingsPageSectionTitle(title: translations.settings.dangerZone.title),
           const DeleteAccountSettingsEntryWidget(),
           const ClearDataSettingsEntryWidget(),
-          if (kDebugMode) ...[
+          // Diagnostics are mostly meaningful in profile builds.
+          if (!kReleaseMode) ...[
             const _SettingsPageSectionTitle(title: 'Debug'),
-            const ShowIntroPageSettingsEntryWidget(),
-            const ContributorPlanStateEntryWidget(),
-            const LocaleEntryWidget(),
-            const RefreshUserSettingsEntryWidget(),
+            if (kDebugMode) ...[
+              const ShowIntroPageSettingsEntryWidget(),
+              const ContributorPlanStateEntryWidget(),
+              const LocaleEntryWidget(),
+              const RefreshUserSettingsEntryWidget(),
+            ],
+            const NativeMetricsSettingsEntryWidget(),
+            const NativeTraceSettingsEntryWidget(),
+            const FrameTimingReportSettingsEntryWidget(),
+            const NativeMemorySettingsEntryWidget(),
+            const StartupTraceSettingsEntryWidget(),
           ],
         ],
       ),
@@ -0,0 +1,80 @@
+import 'dart:convert';
+import 'dart:ui';
+
+import 'package:flutter/scheduler.dart';
+import 'package:flutter/services.dart';
+import 'package:open_authenticator/utils/platform.dart';
+
+/// Records Flutter [FrameTiming]s, and combines them with the frame timings of the Linux runner into a jank report.
+class FrameTimingReport {
+  /// The maximum number of Flutter frame timings to keep.
+  static const int _maxTimings = 3600;
+
+  /// The Linux runner method channel.
+  static const MethodChannel _methodChannel = MethodChannel('app.openauthenticator.runner');
+
+  /// The recorded timings.
+  final List<FrameTiming> _timings = [];
+
+  /// Whether timings are being recorded.
+  bool _recording = false;
+
+  /// Starts recording Flutter frame timings.
+  void start() {
+    if (!_recording) {
+      SchedulerBinding.instance.addTimingsCallback(_onTimings);
+      _recording = true;
+    }
+  }
+
+  /// Stops recording Flutter frame timings.
+  void stop() {
+    if (_recording) {
+      SchedulerBinding.instance.removeTimingsCallback(_onTimings);
+      _recording = false;
+    }
+  }
+
+  /// Builds the report, as JSON. Durations are in microseconds.
+  Future<String> build() async {
+    Map<Object?, Object?>? runner = currentPlatform == Platform.linux ? await _methodChannel.invokeMethod<Map<Object?, Object?>>('frames.report') : null;
+    int refreshInterval = (runner?['refreshInterval'] as int?) ?? 0;
+    int budget = refreshInterval > 0 ? refreshInterval : const Duration(milliseconds: 16, microseconds: 667).inMicroseconds;
+    List<int> build = [for (FrameTiming timing in _timings) timing.buildDuration.inMicroseconds];
+    List<int> raster = [for (FrameTiming timing in _timings) timing.rasterDuration.inMicroseconds];
+    List<int> total = [for (FrameTiming timing in _timings) timing.totalSpan.inMicroseconds];
+    return jsonEncode({
+      'flutter': {
+        'frames': _timings.length,
+        'jankyFrames': total.where((duration) => duration > budget).length,
+        'build': _summarize(build),
+        'raster': _summarize(raster),
+        'total': _summarize(total),
+      },
+      if (runner != null) 'runner': runner.map((key, value) => MapEntry(key.toString(), value)),
+    });
+  }
+
+  /// Called when Flutter reports new frame timings.
+  void _onTimings(List<FrameTiming> timings) {
+    _timings.addAll(timings);
+    if (_timings.length > _maxTimings) {
+      _timings.removeRange(0, _timings.length - _maxTimings);
+    }
+  }
+
+  /// Summarizes the given [durations].
+  Map<String, int> _summarize(List<int> durations) {
+    if (durations.isEmpty) {
+      return {};
+    }
+    List<int> sorted = [...durations]..sort();
+    int percentile(int percent) => sorted[((sorted.length - 1) * percent / 100).floor()];
+    return {
+      'p50': percentile(50),
+      'p90': percentile(90),
+      'p99': percentile(99),
+      'max': sorted.last,
+    };
+  }
+}
@@ -0,0 +1,35 @@
+import 'package:flutter/painting.dart';
+import 'package:flutter/services.dart';
+import 'package:open_authenticator/utils/platform.dart';
+
+/// Allows to read the memory footprint reported by the Linux runner.
+class NativeMemory {
+  /// The Linux runner method channel.
+  static const MethodChannel _methodChannel = MethodChannel('app.openauthenticator.runner');
+
+  /// Returns the memory footprint of the process, or `null` if not supported.
+  /// Sizes are in bytes.
+  ///
+  /// Passing a [samplingInterval] starts appending samples to [samplingPath] (or to a file of the cache directory), and passing [Duration.zero] stops it.
+  static Future<Map<String, dynamic>?> report({Duration? samplingInterval, String? samplingPath}) async {
+    if (currentPlatform != Platform.linux) {
+      return null;
+    }
+    Map<Object?, Object?>? result = await _methodChannel.invokeMethod<Map<Object?, Object?>>('runner.memory', {
+      if (samplingInterval != null) 'samplingInterval': samplingInterval.inMilliseconds,
+      if (samplingPath != null) 'samplingPath': samplingPath,
+    });
+    if (result == null) {
+      return null;
+    }
+    ImageCache imageCache = PaintingBinding.instance.imageCache;
+    return {
+      for (MapEntry<Object?, Object?> entry in result.entries) entry.key.toString(): entry.value,
+      'imageCache': {
+        'size': imageCache.currentSizeBytes,
+        'images': imageCache.currentSize,
+        'liveImages': imageCache.liveImageCount,
+      },
+    };
+  }
+}
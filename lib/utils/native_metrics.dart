@@ -0,0 +1,20 @@
+import 'dart:convert';
+
+import 'package:flutter/services.dart';
+import 'package:open_authenticator/utils/platform.dart';
+
+/// Allows to read the metrics recorded by the native runners.
+class NativeMetrics {
+  /// Returns the channel the current runner answers `metrics.snapshot` on, if any.
+  static MethodChannel? get _methodChannel => switch (currentPlatform) {
+    Platform.linux => const MethodChannel('app.openauthenticator.runner'),
+    Platform.windows => const MethodChannel('app.openauthenticator.auth'),
+    _ => null,
+  };
+
+  /// Returns every counter, gauge and histogram recorded by the runner, or `null` if not supported.
+  static Future<Map<String, dynamic>?> snapshot() async {
+    String? json = await _methodChannel?.invokeMethod<String>('metrics.snapshot');
+    return json == null ? null : jsonDecode(json);
+  }
+}
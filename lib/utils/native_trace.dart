@@ -0,0 +1,29 @@
+import 'package:flutter/services.dart';
+import 'package:open_authenticator/utils/platform.dart';
+
+/// Allows to record the spans of the Linux runner native code, to be opened in Perfetto alongside the Dart timeline.
+class NativeTrace {
+  /// The Linux runner method channel.
+  static const MethodChannel _methodChannel = MethodChannel('app.openauthenticator.runner');
+
+  /// Whether the current runner supports tracing.
+  static bool get isSupported => currentPlatform == Platform.linux;
+
+  /// Enables or disables the recording of native spans.
+  static Future<void> setEnabled(bool enabled) async {
+    if (isSupported) {
+      await _methodChannel.invokeMethod('trace.setEnabled', enabled);
+    }
+  }
+
+  /// Exports the recorded spans using the Chrome trace event format.
+  /// Native timestamps use the same clock as the Dart `Timeline`, [clockOffset] (in microseconds) allowing to shift them anyway.
+  static Future<String?> export({int clockOffset = 0}) async => isSupported ? await _methodChannel.invokeMethod<String>('trace.export', clockOffset) : null;
+
+  /// Drops every recorded span.
+  static Future<void> clear() async {
+    if (isSupported) {
+      await _methodChannel.invokeMethod('trace.clear');
+    }
+  }
+}
@@ -0,0 +1,31 @@
+import 'package:flutter/services.dart';
+import 'package:open_authenticator/utils/platform.dart';
+
+/// Allows to read the startup phases recorded by the Linux runner.
+class StartupTrace {
+  /// The Linux runner method channel.
+  static const MethodChannel _methodChannel = MethodChannel('app.openauthenticator.runner');
+
+  /// Returns the startup trace, or `null` if not supported.
+  /// Times are in microseconds, relative to the start of the runner `main`, except for `main` itself, which is a monotonic timestamp.
+  static Future<Map<String, dynamic>?> read() async {
+    if (currentPlatform != Platform.linux) {
+      return null;
+    }
+    Map<Object?, Object?>? result = await _methodChannel.invokeMethod<Map<Object?, Object?>>('runner.startupTrace');
+    if (result == null) {
+      return null;
+    }
+    List<Object?> phases = result['phases'] as List<Object?>? ?? [];
+    return {
+      'main': result['main'],
+      'firstFrame': result['firstFrame'],
+      'phases': [
+        for (Map<Object?, Object?> phase in phases.whereType<Map<Object?, Object?>>())
+          {
+            for (MapEntry<Object?, Object?> entry in phase.entries) entry.key.toString(): entry.value,
+          },
+      ],
+    };
+  }
+}
@@ -0,0 +1,147 @@
+#include "code_cli.h"
+
+#include <glib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "totp.h"
+#include "vault.h"
+
+static const int kExitNotFound = 1;
+static const int kExitUsage = 2;
+
+bool code_cli_is_requested(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--code") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool read_password(std::string& password) {
+    bool terminal = isatty(STDIN_FILENO);
+    struct termios previous;
+    if (terminal) {
+        std::cerr << "Master password: " << std::flush;
+        tcgetattr(STDIN_FILENO, &previous);
+        struct termios hidden = previous;
+        hidden.c_lflag &= ~ECHO;
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &hidden);
+    }
+    bool success = static_cast<bool>(std::getline(std::cin, password));
+    if (terminal) {
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &previous);
+        std::cerr << std::endl;
+    }
+    return success;
+}
+
+static bool matches_issuer(const std::string& issuer, const char* query) {
+    g_autofree gchar* folded_issuer = g_utf8_casefold(issuer.c_str(), -1);
+    g_autofree gchar* folded_query = g_utf8_casefold(query, -1);
+    return strcmp(folded_issuer, folded_query) == 0;
+}
+
+int code_cli_run(int argc, char** argv) {
+    const char* query = nullptr;
+    const char* database_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--code") == 0 && i + 1 < argc) {
+            query = argv[++i];
+        } else if (strcmp(argv[i], "--database") == 0 && i + 1 < argc) {
+            database_path = argv[++i];
+        } else {
+            query = nullptr;
+            break;
+        }
+    }
+    if (query == nullptr) {
+        std::cerr << "Usage : " << argv[0] << " --code <issuer-or-uuid> [--database <path>]" << std::endl;
+        return kExitUsage;
+    }
+    g_autofree gchar* default_database_path = vault_get_default_path();
+    if (database_path == nullptr) {
+        database_path = default_database_path;
+    }
+
+    std::vector<VaultEntry> entries;
+    std::string error;
+    if (!vault_read_entries(database_path, query, entries, error) || (entries.empty() && !vault_read_entries(database_path, nullptr, entries, error))) {
+        std::cerr << "Cannot read " << database_path << " : " << error << std::endl;
+        return kExitNotFound;
+    }
+    if (entries.empty()) {
+        std::cerr << "No TOTP found." << std::endl;
+        return kExitNotFound;
+    }
+
+    std::string password;
+    if (!read_password(password)) {
+        return kExitUsage;
+    }
+
+    // TOTPs are usually all encrypted with the same key, but derive each one
+    // at most once.
+    std::map<std::vector<uint8_t>, std::vector<uint8_t>> keys;
+    std::vector<const VaultEntry*> matches;
+    bool matched_uuid = entries.size() == 1 && entries.front().uuid == query;
+    for (const VaultEntry& entry : entries) {
+        auto key = keys.find(entry.encryption_salt);
+        if (key == keys.end()) {
+            std::vector<uint8_t> derived_key;
+            if (!vault_derive_key(password, entry.encryption_salt, derived_key)) {
+                continue;
+            }
+            key = keys.emplace(entry.encryption_salt, std::move(derived_key)).first;
+        }
+        if (matched_uuid) {
+            matches.push_back(&entry);
+            break;
+        }
+        std::string issuer;
+        if (!entry.encrypted_issuer.empty() && vault_decrypt(key->second, entry.encrypted_issuer, issuer) && matches_issuer(issuer, query)) {
+            matches.push_back(&entry);
+        }
+    }
+    vault_wipe(password);
+
+    int status = 0;
+    if (matches.empty()) {
+        std::cerr << "No TOTP matches \"" << query << "\", or the password is wrong." << std::endl;
+        status = kExitNotFound;
+    } else if (matches.size() > 1) {
+        std::cerr << "Several TOTPs match \"" << query << "\", use one of their UUIDs :" << std::endl;
+        for (const VaultEntry* entry : matches) {
+            std::cerr << "  " << entry->uuid << std::endl;
+        }
+        status = kExitUsage;
+    } else {
+        const VaultEntry& entry = *matches.front();
+        std::string secret;
+        std::vector<uint8_t> secret_key;
+        std::string code;
+        if (vault_decrypt(keys[entry.encryption_salt], entry.encrypted_secret, secret) && totp_decode_base32(secret, secret_key)) {
+            code = totp_generate_code(secret_key, entry.algorithm.empty() ? kTotpDefaultAlgorithm : entry.algorithm, entry.digits == 0 ? kTotpDefaultDigits : entry.digits, entry.validity == 0 ? kTotpDefaultValidity : entry.validity, time(nullptr));
+        }
+        vault_wipe(secret);
+        vault_wipe(secret_key);
+        if (code.empty()) {
+            std::cerr << "Cannot generate a code for " << entry.uuid << ", the password may be wrong." << std::endl;
+            status = kExitNotFound;
+        } else {
+            std::cout << code << std::endl;
+        }
+    }
+    for (auto& key : keys) {
+        vault_wipe(key.second);
+    }
+    return status;
+}
@@ -0,0 +1,28 @@
+#ifndef FLUTTER_CODE_CLI_H_
+#define FLUTTER_CODE_CLI_H_
+
+/**
+ * code_cli_is_requested:
+ * @argc: the argument count.
+ * @argv: the arguments.
+ *
+ * Returns: whether the application has been launched to print a code, with
+ * `--code <issuer-or-uuid>`.
+ */
+bool code_cli_is_requested(int argc, char** argv);
+
+/**
+ * code_cli_run:
+ * @argc: the argument count.
+ * @argv: the arguments.
+ *
+ * Prints the current code of a TOTP, without creating any window or engine.
+ * The master password is read from the terminal, or from the standard input
+ * if it isn't a terminal. Usage :
+ * `open_authenticator --code <issuer-or-uuid> [--database <path>]`.
+ *
+ * Returns: the exit status of the process.
+ */
+int code_cli_run(int argc, char** argv);
+
+#endif  // FLUTTER_CODE_CLI_H_
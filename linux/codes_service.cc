@@ -0,0 +1,306 @@
+#include "codes_service.h"
+
+#include <gio/gunixfdlist.h>
+#include <polkit/polkit.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "metrics.h"
+#include "totp.h"
+#include "trace.h"
+#include "vault.h"
+
+// Missing from the headers older than Linux 5.1, but the same on every
+// architecture but Alpha.
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+static const gchar introspection_xml[] =
+    "<node>"
+    "  <interface name='app.openauthenticator.Codes'>"
+    "    <method name='ListAccounts'>"
+    "      <arg type='a(sss)' name='accounts' direction='out'/>"
+    "    </method>"
+    "    <method name='GetCode'>"
+    "      <arg type='s' name='uuid' direction='in'/>"
+    "      <arg type='s' name='code' direction='out'/>"
+    "      <arg type='x' name='valid_until' direction='out'/>"
+    "    </method>"
+    "    <method name='GetCodes'>"
+    "      <arg type='as' name='uuids' direction='in'/>"
+    "      <arg type='a(ssx)' name='codes' direction='out'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+// The polkit action that callers must be authorized for.
+static const gchar* const polkit_action = "app.openauthenticator.sensibleAction";
+
+// Only accessed from the main thread.
+static guint registration_id = 0;
+static std::vector<uint8_t> key;
+
+// The database entries, reloaded when the database changes.
+static std::vector<VaultEntry> entries;
+static gint64 entries_modification_time = -1;
+
+static metrics::Gauge& secret_store_bytes = metrics::Registry::Get().GetGauge("memory.secret_store_bytes");
+
+static void return_error(GDBusMethodInvocation* invocation, const gchar* name, const gchar* message) {
+    g_dbus_method_invocation_return_dbus_error(invocation, name, message);
+}
+
+static gint64 get_modification_time(const gchar* path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_mtim.tv_sec * G_USEC_PER_SEC + st.st_mtim.tv_nsec / 1000 : 0;
+}
+
+// Reports the memory held by the key and the cached entries.
+static void update_secret_store_bytes() {
+    size_t size = key.capacity() + entries.capacity() * sizeof(VaultEntry);
+    for (const VaultEntry& entry : entries) {
+        size += entry.uuid.capacity() + entry.encrypted_secret.capacity() + entry.encrypted_label.capacity() + entry.encrypted_issuer.capacity() + entry.encryption_salt.capacity() + entry.algorithm.capacity();
+    }
+    secret_store_bytes.Set(static_cast<int64_t>(size));
+}
+
+static bool load_entries(std::string& error) {
+    g_autofree gchar* path = vault_get_default_path();
+    g_autofree gchar* wal_path = g_strconcat(path, "-wal", nullptr);
+    gint64 modification_time = MAX(get_modification_time(path), get_modification_time(wal_path));
+    if (modification_time == entries_modification_time) {
+        return true;
+    }
+    std::vector<VaultEntry> new_entries;
+    if (!vault_read_entries(path, nullptr, new_entries, error)) {
+        return false;
+    }
+    entries.swap(new_entries);
+    entries_modification_time = modification_time;
+    update_secret_store_bytes();
+    return true;
+}
+
+static bool generate_code(const VaultEntry& entry, time_t now, std::string& code) {
+    std::string secret;
+    std::vector<uint8_t> secret_key;
+    if (vault_decrypt(key, entry.encrypted_secret, secret) && totp_decode_base32(secret, secret_key)) {
+        code = totp_generate_code(secret_key, entry.algorithm.empty() ? kTotpDefaultAlgorithm : entry.algorithm, entry.digits == 0 ? kTotpDefaultDigits : entry.digits, entry.validity == 0 ? kTotpDefaultValidity : entry.validity, now);
+    }
+    vault_wipe(secret);
+    vault_wipe(secret_key);
+    return !code.empty();
+}
+
+static gint64 get_valid_until(const VaultEntry& entry, time_t now) {
+    int validity = entry.validity == 0 ? kTotpDefaultValidity : entry.validity;
+    return (now / validity + 1) * validity;
+}
+
+static const VaultEntry* find_entry(const gchar* uuid) {
+    for (const VaultEntry& entry : entries) {
+        if (entry.uuid == uuid) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+static void list_accounts(GDBusMethodInvocation* invocation) {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(sss)"));
+    for (const VaultEntry& entry : entries) {
+        std::string issuer;
+        std::string label;
+        if ((!entry.encrypted_issuer.empty() && !vault_decrypt(key, entry.encrypted_issuer, issuer)) || (!entry.encrypted_label.empty() && !vault_decrypt(key, entry.encrypted_label, label))) {
+            // Encrypted with another key.
+            continue;
+        }
+        g_variant_builder_add(&builder, "(sss)", entry.uuid.c_str(), issuer.c_str(), label.c_str());
+    }
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(a(sss))", &builder));
+}
+
+static void get_code(GDBusMethodInvocation* invocation, const gchar* uuid) {
+    const VaultEntry* entry = find_entry(uuid);
+    time_t now = time(nullptr);
+    std::string code;
+    if (entry == nullptr || !generate_code(*entry, now, code)) {
+        return_error(invocation, "app.openauthenticator.Codes.Error.NotFound", "No TOTP can be decrypted with this UUID.");
+        return;
+    }
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(sx)", code.c_str(), get_valid_until(*entry, now)));
+}
+
+static void get_codes(GDBusMethodInvocation* invocation, GVariant* uuids) {
+    time_t now = time(nullptr);
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(ssx)"));
+    GVariantIter iter;
+    g_variant_iter_init(&iter, uuids);
+    const gchar* uuid;
+    while (g_variant_iter_next(&iter, "&s", &uuid)) {
+        const VaultEntry* entry = find_entry(uuid);
+        std::string code;
+        // Unknown TOTPs are skipped rather than failing the whole batch.
+        if (entry != nullptr && generate_code(*entry, now, code)) {
+            g_variant_builder_add(&builder, "(ssx)", uuid, code.c_str(), get_valid_until(*entry, now));
+        }
+    }
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(a(ssx))", &builder));
+}
+
+// Serves an authorized call.
+static void serve(GDBusMethodInvocation* invocation) {
+    static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("codes_service.serve_us");
+    metrics::ScopedTimer timer(latency);
+    TraceSpan span("codesService.serve");
+    if (key.empty()) {
+        return_error(invocation, "app.openauthenticator.Codes.Error.Locked", "Open Authenticator is locked.");
+        return;
+    }
+    std::string error;
+    if (!load_entries(error)) {
+        return_error(invocation, "app.openauthenticator.Codes.Error.Failed", error.c_str());
+        return;
+    }
+    const gchar* method = g_dbus_method_invocation_get_method_name(invocation);
+    GVariant* parameters = g_dbus_method_invocation_get_parameters(invocation);
+    if (g_strcmp0(method, "ListAccounts") == 0) {
+        list_accounts(invocation);
+    } else if (g_strcmp0(method, "GetCode") == 0) {
+        const gchar* uuid;
+        g_variant_get(parameters, "(&s)", &uuid);
+        get_code(invocation, uuid);
+    } else {
+        g_autoptr(GVariant) uuids = g_variant_get_child_value(parameters, 0);
+        get_codes(invocation, uuids);
+    }
+}
+
+static void check_authorization_cb(GObject* source, GAsyncResult* result, gpointer user_data) {
+    auto* invocation = static_cast<GDBusMethodInvocation*>(user_data);
+    g_autoptr(GError) error = nullptr;
+    PolkitAuthorizationResult* authorization = polkit_authority_check_authorization_finish(POLKIT_AUTHORITY(source), result, &error);
+    if (authorization == nullptr || !polkit_authorization_result_get_is_authorized(authorization)) {
+        static metrics::Counter& denied = metrics::Registry::Get().GetCounter("codes_service.denied");
+        denied.Increment();
+        return_error(invocation, "app.openauthenticator.Codes.Error.NotAuthorized", error == nullptr ? "Not authorized." : error->message);
+    } else {
+        serve(invocation);
+    }
+    g_clear_object(&authorization);
+    g_object_unref(invocation);
+}
+
+// Returns the polkit subject of the caller, as session bus names aren't polkit
+// subjects. A PID alone could be reused by another process before polkit reads
+// it, so the process is identified by its pidfd when the bus provides one, and
+// its user by the bus rather than by polkit. Takes ownership of @pidfd.
+static PolkitSubject* new_caller_subject(guint32 pid, guint32 uid, gint pidfd) {
+#ifdef HAVE_POLKIT_PIDFD
+    if (pidfd >= 0) {
+        // polkit duplicates the pidfd.
+        PolkitSubject* subject = polkit_unix_process_new_pidfd(pidfd, uid, nullptr);
+        close(pidfd);
+        return subject;
+    }
+#endif
+    // polkit reads the start time of the process, which tells it apart from a
+    // later one reusing its PID. If the process is still alive after that, the
+    // start time is the one of the caller.
+    PolkitSubject* subject = polkit_unix_process_new_for_owner(pid, 0, uid);
+    if (pidfd >= 0) {
+        bool alive = syscall(SYS_pidfd_send_signal, pidfd, 0, nullptr, 0) == 0;
+        close(pidfd);
+        if (!alive) {
+            g_object_unref(subject);
+            return nullptr;
+        }
+    }
+    return subject;
+}
+
+// Checks whether the caller process is authorized.
+static void get_caller_credentials_cb(GObject* source, GAsyncResult* result, gpointer user_data) {
+    auto* invocation = static_cast<GDBusMethodInvocation*>(user_data);
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(GUnixFDList) fd_list = nullptr;
+    g_autoptr(GVariant) credentials = g_dbus_connection_call_with_unix_fd_list_finish(G_DBUS_CONNECTION(source), &fd_list, result, &error);
+    guint32 pid = 0;
+    guint32 uid = 0;
+    g_autoptr(GVariant) credentials_map = credentials == nullptr ? nullptr : g_variant_get_child_value(credentials, 0);
+    if (credentials_map == nullptr || !g_variant_lookup(credentials_map, "ProcessID", "u", &pid) || !g_variant_lookup(credentials_map, "UnixUserID", "u", &uid)) {
+        return_error(invocation, "app.openauthenticator.Codes.Error.NotAuthorized", "Cannot identify the caller.");
+        g_object_unref(invocation);
+        return;
+    }
+    // Only provided by recent buses.
+    gint pidfd = -1;
+    gint32 pidfd_index = 0;
+    if (fd_list != nullptr && g_variant_lookup(credentials_map, "ProcessFD", "h", &pidfd_index)) {
+        pidfd = g_unix_fd_list_get(fd_list, pidfd_index, nullptr);
+    }
+    PolkitSubject* subject = new_caller_subject(pid, uid, pidfd);
+    if (subject == nullptr) {
+        return_error(invocation, "app.openauthenticator.Codes.Error.NotAuthorized", "The caller has exited.");
+        g_object_unref(invocation);
+        return;
+    }
+    PolkitAuthority* authority = polkit_authority_get_sync(nullptr, &error);
+    if (authority == nullptr) {
+        return_error(invocation, "app.openauthenticator.Codes.Error.NotAuthorized", error == nullptr ? "polkit is unavailable." : error->message);
+        g_object_unref(subject);
+        g_object_unref(invocation);
+        return;
+    }
+    polkit_authority_check_authorization(authority, subject, polkit_action, nullptr, POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION, nullptr, check_authorization_cb, invocation);
+    g_object_unref(subject);
+    g_object_unref(authority);
+}
+
+static void method_call_cb(GDBusConnection* connection, const gchar* sender, const gchar* object_path, const gchar* interface_name, const gchar* method_name, GVariant* parameters, GDBusMethodInvocation* invocation, gpointer user_data) {
+    static metrics::Counter& calls = metrics::Registry::Get().GetCounter("codes_service.calls");
+    calls.Increment();
+    g_dbus_connection_call_with_unix_fd_list(connection, "org.freedesktop.DBus", "/org/freedesktop/DBus", "org.freedesktop.DBus", "GetConnectionCredentials", g_variant_new("(s)", sender), G_VARIANT_TYPE("(a{sv})"), G_DBUS_CALL_FLAGS_NONE, -1, nullptr, nullptr, get_caller_credentials_cb, g_object_ref(invocation));
+}
+
+static const GDBusInterfaceVTable interface_vtable = {method_call_cb, nullptr, nullptr, {nullptr}};
+
+gboolean codes_service_register(GDBusConnection* connection, const gchar* object_path, GError** error) {
+    g_autoptr(GDBusNodeInfo) node_info = g_dbus_node_info_new_for_xml(introspection_xml, error);
+    if (node_info == nullptr) {
+        return FALSE;
+    }
+    registration_id = g_dbus_connection_register_object(connection, object_path, node_info->interfaces[0], &interface_vtable, nullptr, nullptr, error);
+    return registration_id != 0;
+}
+
+void codes_service_unregister(GDBusConnection* connection) {
+    if (registration_id != 0) {
+        g_dbus_connection_unregister_object(connection, registration_id);
+        registration_id = 0;
+    }
+}
+
+void codes_service_set_key(const std::vector<uint8_t>& new_key) {
+    codes_service_clear_key();
+    key.assign(new_key.begin(), new_key.end());
+    // Keep it out of the swap.
+    mlock(key.data(), key.size());
+    update_secret_store_bytes();
+}
+
+void codes_service_clear_key() {
+    if (!key.empty()) {
+        munlock(key.data(), key.size());
+    }
+    vault_wipe(key);
+    std::vector<uint8_t>().swap(key);
+    update_secret_store_bytes();
+}
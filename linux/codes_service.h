@@ -0,0 +1,45 @@
+#ifndef FLUTTER_CODES_SERVICE_H_
+#define FLUTTER_CODES_SERVICE_H_
+
+#include <gio/gio.h>
+#include <stdint.h>
+
+#include <vector>
+
+/**
+ * codes_service_register:
+ * @connection: the connection of the application.
+ * @object_path: the object path of the application.
+ * @error: the error, if any.
+ *
+ * Exports the `app.openauthenticator.Codes` interface, which allows other
+ * desktop tools to get codes without going through the app UI. Every call is
+ * authorized using polkit, and served without involving Dart.
+ *
+ * Returns: whether the interface has been exported.
+ */
+gboolean codes_service_register(GDBusConnection* connection, const gchar* object_path, GError** error);
+
+/**
+ * codes_service_unregister:
+ * @connection: the connection the interface has been exported on.
+ */
+void codes_service_unregister(GDBusConnection* connection);
+
+/**
+ * codes_service_set_key:
+ * @key: the key the TOTPs are encrypted with.
+ *
+ * Allows the service to decrypt TOTPs, which it refuses to do otherwise. Set by
+ * Dart when the app gets unlocked.
+ */
+void codes_service_set_key(const std::vector<uint8_t>& key);
+
+/**
+ * codes_service_clear_key:
+ *
+ * Forgets the key, when the app gets locked.
+ */
+void codes_service_clear_key();
+
+#endif  // FLUTTER_CODES_SERVICE_H_
@@ -0,0 +1,96 @@
+#include "frame_stats.h"
+
+#include "metrics.h"
+
+// Frames further apart than that are considered as a new animation, rather
+// than as missing vertical syncs.
+static const gint64 kIdleInterval = 250 * 1000;
+
+// Only accessed from the main thread.
+static gint64 last_frame_counter = -1;
+static gint64 last_frame_time = 0;
+
+static metrics::Histogram& frame_intervals = metrics::Registry::Get().GetHistogram("frames.interval_us");
+static metrics::Histogram& presentation_latencies = metrics::Registry::Get().GetHistogram("frames.presentation_latency_us");
+static metrics::Counter& frame_count = metrics::Registry::Get().GetCounter("frames.count");
+static metrics::Counter& missed_vsyncs = metrics::Registry::Get().GetCounter("frames.missed_vsyncs");
+static metrics::Gauge& refresh_interval = metrics::Registry::Get().GetGauge("frames.refresh_interval_us");
+
+static void record_frame(GdkFrameTimings* timings) {
+    gint64 frame_time = gdk_frame_timings_get_frame_time(timings);
+    gint64 presentation_time = gdk_frame_timings_get_presentation_time(timings);
+    gint64 interval = gdk_frame_timings_get_refresh_interval(timings);
+    frame_count.Increment();
+    if (interval > 0) {
+        refresh_interval.Set(interval);
+    }
+    if (presentation_time > frame_time) {
+        presentation_latencies.Record(presentation_time - frame_time);
+    }
+    if (last_frame_time != 0 && frame_time - last_frame_time < kIdleInterval) {
+        gint64 frame_interval = frame_time - last_frame_time;
+        frame_intervals.Record(frame_interval);
+        if (interval > 0) {
+            // Rounded, as frame times jitter around the refresh interval.
+            gint64 vsyncs = (frame_interval + interval / 2) / interval;
+            if (vsyncs > 1) {
+                missed_vsyncs.Increment(vsyncs - 1);
+            }
+        }
+    }
+    last_frame_time = frame_time;
+}
+
+// Timings are only complete once the frame has been presented, so they are
+// recorded a few frames later.
+static void after_paint_cb(GdkFrameClock* clock, gpointer user_data) {
+    gint64 current = gdk_frame_clock_get_frame_counter(clock);
+    gint64 first = MAX(last_frame_counter + 1, gdk_frame_clock_get_history_start(clock));
+    for (gint64 counter = first; counter <= current; counter++) {
+        GdkFrameTimings* timings = gdk_frame_clock_get_timings(clock, counter);
+        if (timings == nullptr) {
+            continue;
+        }
+        if (!gdk_frame_timings_get_complete(timings)) {
+            break;
+        }
+        record_frame(timings);
+        last_frame_counter = counter;
+    }
+}
+
+static void realize_cb(GtkWidget* widget, gpointer user_data) {
+    GdkFrameClock* clock = gtk_widget_get_frame_clock(widget);
+    if (clock != nullptr) {
+        g_signal_connect(clock, "after-paint", G_CALLBACK(after_paint_cb), nullptr);
+    }
+}
+
+void frame_stats_attach(GtkWidget* widget) {
+    if (gtk_widget_get_realized(widget)) {
+        realize_cb(widget, nullptr);
+    } else {
+        g_signal_connect(widget, "realize", G_CALLBACK(realize_cb), nullptr);
+    }
+}
+
+static FlValue* histogram_to_value(const metrics::Histogram& histogram) {
+    metrics::Histogram::Snapshot snapshot = histogram.GetSnapshot();
+    FlValue* value = fl_value_new_map();
+    fl_value_set_string_take(value, "count", fl_value_new_int(snapshot.count));
+    fl_value_set_string_take(value, "mean", fl_value_new_int(snapshot.count == 0 ? 0 : snapshot.sum / snapshot.count));
+    fl_value_set_string_take(value, "p50", fl_value_new_int(snapshot.Percentile(50)));
+    fl_value_set_string_take(value, "p90", fl_value_new_int(snapshot.Percentile(90)));
+    fl_value_set_string_take(value, "p99", fl_value_new_int(snapshot.Percentile(99)));
+    return value;
+}
+
+FlValue* frame_stats_to_value() {
+    FlValue* result = fl_value_new_map();
+    fl_value_set_string_take(result, "frames", fl_value_new_int(frame_count.Value()));
+    fl_value_set_string_take(result, "missedVsyncs", fl_value_new_int(missed_vsyncs.Value()));
+    fl_value_set_string_take(result, "refreshInterval", fl_value_new_int(refresh_interval.Value()));
+    fl_value_set_string_take(result, "intervals", histogram_to_value(frame_intervals));
+    fl_value_set_string_take(result, "presentationLatencies", histogram_to_value(presentation_latencies));
+    return result;
+}
@@ -0,0 +1,25 @@
+#ifndef FLUTTER_FRAME_STATS_H_
+#define FLUTTER_FRAME_STATS_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+/**
+ * frame_stats_attach:
+ * @widget: the widget whose frames should be recorded.
+ *
+ * Records the timings of every frame painted by the frame clock of @widget :
+ * intervals between frames, missed vertical syncs and compositor latency. Can
+ * be called before @widget is realized.
+ */
+void frame_stats_attach(GtkWidget* widget);
+
+/**
+ * frame_stats_to_value:
+ *
+ * Returns: the recorded timings, as a map that can be sent to Dart. Durations
+ * are in microseconds.
+ */
+FlValue* frame_stats_to_value();
+
+#endif  // FLUTTER_FRAME_STATS_H_
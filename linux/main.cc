@@ -1,6 +1,14 @@
+#include "code_cli.h"
 #include "my_application.h"
+#include "startup_trace.h"
 
 int main(int argc, char** argv) {
+  // Scripts only want a code : don't initialize GTK nor Flutter.
+  if (code_cli_is_requested(argc, argv)) {
+    return code_cli_run(argc, argv);
+  }
+
+  startup_trace_start();
   g_autoptr(MyApplication) app = my_application_new();
   return g_application_run(G_APPLICATION(app), argc, argv);
 }
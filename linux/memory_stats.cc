@@ -0,0 +1,227 @@
+#include "memory_stats.h"
+
+#include <malloc.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "metrics.h"
+
+// mallinfo2() was added by glibc 2.33, which deprecates mallinfo().
+#ifdef __GLIBC_PREREQ
+#if __GLIBC_PREREQ(2, 33)
+#define HAVE_MALLINFO2
+#endif
+#endif
+
+// Fields of /proc/self/smaps_rollup, in bytes.
+struct RollupStats {
+    gint64 rss = 0;
+    gint64 pss = 0;
+    gint64 pss_anonymous = 0;
+    gint64 pss_file = 0;
+    gint64 anonymous = 0;
+    gint64 swap = 0;
+};
+
+// The statistics of the malloc arenas, in bytes.
+struct MallocStats {
+    size_t arena = 0;
+    size_t mapped = 0;
+    size_t in_use = 0;
+    size_t free = 0;
+    size_t releasable = 0;
+    size_t free_chunks = 0;
+};
+
+// The files mapped by the Flutter engine. Their resident pages are the part of
+// the engine footprint that doesn't depend on the GPU driver.
+static const gchar* const engine_files[] = {
+    "libflutter_linux_gtk.so",
+    "libapp.so",
+    "icudtl.dat",
+};
+
+// Only accessed from the main thread.
+static guint sampling_source = 0;
+static FILE* sampling_file = nullptr;
+
+static metrics::Gauge& secret_store_bytes = metrics::Registry::Get().GetGauge("memory.secret_store_bytes");
+static metrics::Gauge& crypto_buffers_bytes = metrics::Registry::Get().GetGauge("memory.crypto_buffers_bytes");
+
+// Parses a "Name:   1234 kB" line of a smaps file.
+static bool parse_kilobytes(const gchar* line, const gchar* name, gint64& value) {
+    size_t length = strlen(name);
+    if (strncmp(line, name, length) != 0 || line[length] != ':') {
+        return false;
+    }
+    value = g_ascii_strtoll(line + length + 1, nullptr, 10) * 1024;
+    return true;
+}
+
+static RollupStats read_rollup_stats() {
+    RollupStats stats;
+    FILE* file = fopen("/proc/self/smaps_rollup", "r");
+    if (file == nullptr) {
+        return stats;
+    }
+    gchar line[256];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        parse_kilobytes(line, "Rss", stats.rss) ||
+            parse_kilobytes(line, "Pss", stats.pss) ||
+            parse_kilobytes(line, "Pss_Anon", stats.pss_anonymous) ||
+            parse_kilobytes(line, "Pss_File", stats.pss_file) ||
+            parse_kilobytes(line, "Anonymous", stats.anonymous) ||
+            parse_kilobytes(line, "Swap", stats.swap);
+    }
+    fclose(file);
+    return stats;
+}
+
+static MallocStats read_malloc_stats() {
+    MallocStats stats;
+#if defined(HAVE_MALLINFO2)
+    struct mallinfo2 info = mallinfo2();
+    stats.arena = info.arena;
+    stats.mapped = info.hblkhd;
+    stats.in_use = info.uordblks;
+    stats.free = info.fordblks;
+    stats.releasable = info.keepcost;
+    stats.free_chunks = info.ordblks;
+#elif defined(__GLIBC__)
+    // The fields are ints, which wrap around past 2 GiB. Reading them as
+    // unsigned at least doubles that.
+    struct mallinfo info = mallinfo();
+    stats.arena = static_cast<unsigned int>(info.arena);
+    stats.mapped = static_cast<unsigned int>(info.hblkhd);
+    stats.in_use = static_cast<unsigned int>(info.uordblks);
+    stats.free = static_cast<unsigned int>(info.fordblks);
+    stats.releasable = static_cast<unsigned int>(info.keepcost);
+    stats.free_chunks = static_cast<unsigned int>(info.ordblks);
+#endif
+    return stats;
+}
+
+static int get_engine_file_index(gchar* line) {
+    // Mapping lines end with the path of the mapped file, if any.
+    const gchar* path = strchr(g_strchomp(line), '/');
+    if (path == nullptr) {
+        return -1;
+    }
+    for (size_t i = 0; i < G_N_ELEMENTS(engine_files); i++) {
+        if (g_str_has_suffix(path, engine_files[i])) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// Sums the resident pages of the engine files. Walks the whole
+// /proc/self/smaps, so it is only done on demand.
+static void read_engine_stats(gint64 (&resident)[G_N_ELEMENTS(engine_files)]) {
+    memset(resident, 0, sizeof(resident));
+    FILE* file = fopen("/proc/self/smaps", "r");
+    if (file == nullptr) {
+        return;
+    }
+    int index = -1;
+    gchar line[4096];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        // Field lines start with "Name:", mapping lines with an address range.
+        const gchar* separator = strpbrk(line, " \n");
+        if (separator == nullptr || separator == line || separator[-1] != ':') {
+            index = get_engine_file_index(line);
+            continue;
+        }
+        gint64 value = 0;
+        if (index >= 0 && parse_kilobytes(line, "Rss", value)) {
+            resident[index] += value;
+        }
+    }
+    fclose(file);
+}
+
+FlValue* memory_stats_to_value() {
+    RollupStats rollup = read_rollup_stats();
+    MallocStats malloc_stats = read_malloc_stats();
+    gint64 engine_resident[G_N_ELEMENTS(engine_files)];
+    read_engine_stats(engine_resident);
+
+    FlValue* process = fl_value_new_map();
+    fl_value_set_string_take(process, "rss", fl_value_new_int(rollup.rss));
+    fl_value_set_string_take(process, "pss", fl_value_new_int(rollup.pss));
+    fl_value_set_string_take(process, "pssAnonymous", fl_value_new_int(rollup.pss_anonymous));
+    fl_value_set_string_take(process, "pssFile", fl_value_new_int(rollup.pss_file));
+    fl_value_set_string_take(process, "anonymous", fl_value_new_int(rollup.anonymous));
+    fl_value_set_string_take(process, "swap", fl_value_new_int(rollup.swap));
+
+    FlValue* malloc_value = fl_value_new_map();
+    fl_value_set_string_take(malloc_value, "arena", fl_value_new_int(malloc_stats.arena));
+    fl_value_set_string_take(malloc_value, "mapped", fl_value_new_int(malloc_stats.mapped));
+    fl_value_set_string_take(malloc_value, "inUse", fl_value_new_int(malloc_stats.in_use));
+    fl_value_set_string_take(malloc_value, "free", fl_value_new_int(malloc_stats.free));
+    fl_value_set_string_take(malloc_value, "releasable", fl_value_new_int(malloc_stats.releasable));
+    fl_value_set_string_take(malloc_value, "freeChunks", fl_value_new_int(malloc_stats.free_chunks));
+
+    FlValue* native = fl_value_new_map();
+    fl_value_set_string_take(native, "secretStore", fl_value_new_int(secret_store_bytes.Value()));
+    fl_value_set_string_take(native, "cryptoBuffers", fl_value_new_int(crypto_buffers_bytes.Value()));
+
+    FlValue* engine = fl_value_new_map();
+    for (size_t i = 0; i < G_N_ELEMENTS(engine_files); i++) {
+        fl_value_set_string_take(engine, engine_files[i], fl_value_new_int(engine_resident[i]));
+    }
+
+    FlValue* result = fl_value_new_map();
+    fl_value_set_string_take(result, "process", process);
+    fl_value_set_string_take(result, "malloc", malloc_value);
+    fl_value_set_string_take(result, "native", native);
+    fl_value_set_string_take(result, "engine", engine);
+    return result;
+}
+
+static gboolean sample_cb(gpointer user_data) {
+    RollupStats rollup = read_rollup_stats();
+    MallocStats malloc_stats = read_malloc_stats();
+    fprintf(sampling_file, "%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ",%zu,%zu,%zu,%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT "\n",
+            g_get_real_time(), rollup.rss, rollup.pss, rollup.anonymous, malloc_stats.arena + malloc_stats.mapped, malloc_stats.in_use, malloc_stats.free,
+            static_cast<gint64>(secret_store_bytes.Value()), static_cast<gint64>(crypto_buffers_bytes.Value()));
+    fflush(sampling_file);
+    return G_SOURCE_CONTINUE;
+}
+
+gchar* memory_stats_start_sampling(guint interval_ms, const gchar* path) {
+    memory_stats_stop_sampling();
+    gchar* sampling_path;
+    if (path != nullptr) {
+        sampling_path = g_strdup(path);
+    } else {
+        g_autofree gchar* directory = g_build_filename(g_get_user_cache_dir(), APPLICATION_ID, nullptr);
+        g_mkdir_with_parents(directory, 0700);
+        sampling_path = g_build_filename(directory, "memory_samples.csv", nullptr);
+    }
+    sampling_file = fopen(sampling_path, "a");
+    if (sampling_file == nullptr) {
+        g_warning("Failed to open %s: %s", sampling_path, g_strerror(errno));
+        g_free(sampling_path);
+        return nullptr;
+    }
+    if (ftell(sampling_file) == 0) {
+        fputs("time_us,rss,pss,anonymous,malloc_total,malloc_in_use,malloc_free,secret_store,crypto_buffers\n", sampling_file);
+    }
+    sample_cb(nullptr);
+    sampling_source = g_timeout_add(MAX(interval_ms, 100u), sample_cb, nullptr);
+    return sampling_path;
+}
+
+void memory_stats_stop_sampling() {
+    if (sampling_source != 0) {
+        g_source_remove(sampling_source);
+        sampling_source = 0;
+    }
+    if (sampling_file != nullptr) {
+        fclose(sampling_file);
+        sampling_file = nullptr;
+    }
+}
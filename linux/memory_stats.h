@@ -0,0 +1,36 @@
+#ifndef FLUTTER_MEMORY_STATS_H_
+#define FLUTTER_MEMORY_STATS_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+/**
+ * memory_stats_to_value:
+ *
+ * Returns: the memory footprint of the process, as a map that can be sent to
+ * Dart : resident and proportional set sizes, malloc arenas, native secret
+ * store and crypto buffers, and pages mapped by the engine. Sizes are in
+ * bytes.
+ */
+FlValue* memory_stats_to_value();
+
+/**
+ * memory_stats_start_sampling:
+ * @interval_ms: the time between two samples.
+ * @path: (allow-none): the CSV file to append the samples to, or %NULL to use
+ * the cache directory.
+ *
+ * Periodically appends the memory footprint to a file, so that leaks can be
+ * bisected over long sessions. Restarts sampling if already running.
+ *
+ * Returns: the path of the file, to be freed with g_free().
+ */
+gchar* memory_stats_start_sampling(guint interval_ms, const gchar* path);
+
+/**
+ * memory_stats_stop_sampling:
+ *
+ * Stops sampling, if running.
+ */
+void memory_stats_stop_sampling();
+
+#endif  // FLUTTER_MEMORY_STATS_H_
@@ -11,16 +11,29 @@
 #include <map>
 #include <memory>
 
+#include "codes_service.h"
 #include "flutter/generated_plugin_registrant.h"
+#include "frame_stats.h"
+#include "memory_stats.h"
+#include "metrics.h"
+#include "prewarm.h"
+#include "startup_trace.h"
+#include "totp_import.h"
+#include "trace.h"
+#include "vault.h"
 
 struct _MyApplication {
     GtkApplication parent_instance;
     char** dart_entrypoint_arguments;
+    FlMethodChannel* runner_channel;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
 
 static void can_authenticate(FlMethodCall* method_call) {
+    static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("polkit.can_authenticate_us");
+    metrics::ScopedTimer timer(latency);
+    TraceSpan span("polkit.canAuthenticate");
     GError* error = nullptr;
     PolkitAuthority* authority = polkit_authority_get_sync(nullptr, &error);
     if (error) {
@@ -67,13 +80,24 @@ static void can_authenticate(FlMethodCall* method_call) {
     fl_method_call_respond(method_call, FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(success))), nullptr);
 }
 
+// The authentication requests that are waiting for polkit.
+static metrics::Gauge& pending_authentications = metrics::Registry::Get().GetGauge("polkit.authenticate.pending");
+
 static void authenticate_async_callback(PolkitAuthority* authority, GAsyncResult* result, gpointer user_data) {
+    static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("polkit.authenticate_us");
+    static metrics::Counter& authorized = metrics::Registry::Get().GetCounter("polkit.authenticate.authorized");
+    static metrics::Counter& errors = metrics::Registry::Get().GetCounter("polkit.authenticate.errors");
     GError* error = nullptr;
 
     PolkitAuthorizationResult* auth_result = polkit_authority_check_authorization_finish(authority, result, &error);
+    pending_authentications.Add(-1);
+    gint64 start = *static_cast<gint64*>(g_object_get_data(G_OBJECT(user_data), "start"));
+    latency.Record(g_get_monotonic_time() - start);
+    trace_add_span("polkit.authenticate", start);
 
     if (error) {
         std::cout << error->message << std::endl;
+        errors.Increment();
         fl_method_call_respond((FlMethodCall*)user_data, FL_METHOD_RESPONSE(fl_method_error_response_new("authError", error->message, nullptr)), nullptr);
         g_clear_error(&error);
         g_object_unref(user_data);
@@ -86,6 +110,9 @@ static void authenticate_async_callback(PolkitAuthority* authority, GAsyncResult
     }
 
     gboolean success = polkit_authorization_result_get_is_authorized(auth_result);
+    if (success) {
+        authorized.Increment();
+    }
     fl_method_call_respond((FlMethodCall*)user_data, FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_bool(success))), nullptr);
 
     g_object_unref(user_data);
@@ -111,6 +138,7 @@ static PolkitSubject* make_subject_from_system_bus(GError** error) {
 }
 
 static void authenticate(const std::string reason, FlMethodCall* method_call) {
+    TraceSpan span("polkit.requestAuthentication");
     GError* error = nullptr;
     PolkitAuthority* authority = polkit_authority_get_sync(nullptr, &error);
     if (error || authority == nullptr) {
@@ -127,6 +155,12 @@ static void authenticate(const std::string reason, FlMethodCall* method_call) {
         return;
     }
 
+    static metrics::Counter& calls = metrics::Registry::Get().GetCounter("polkit.authenticate.calls");
+    calls.Increment();
+    pending_authentications.Add(1);
+    gint64* start = g_new(gint64, 1);
+    *start = g_get_monotonic_time();
+    g_object_set_data_full(G_OBJECT(method_call), "start", start, g_free);
     polkit_authority_check_authorization(
         authority,
         subject,
@@ -154,6 +188,136 @@ static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
     }
 }
 
+static FlValue* encrypted_value(const std::vector<uint8_t>& data) {
+    return fl_value_new_uint8_list(data.data(), data.size());
+}
+
+// Reads the TOTPs of @text and encrypts them with @key, in a single call.
+static FlMethodResponse* import_totps(const std::string& text, const std::vector<uint8_t>& key) {
+    TraceSpan span("totps.import");
+    std::vector<ImportedTotp> totps;
+    int rejected = totp_import_parse(text, totps);
+
+    // Secrets, labels and issuers, in that order.
+    std::vector<const std::string*> texts;
+    texts.reserve(totps.size() * 3);
+    for (const ImportedTotp& totp : totps) {
+        texts.push_back(&totp.secret);
+        texts.push_back(&totp.label);
+        if (totp.has_issuer) {
+            texts.push_back(&totp.issuer);
+        }
+    }
+    std::vector<std::vector<uint8_t>> encrypted;
+    if (!vault_encrypt(key, texts, encrypted)) {
+        totp_import_wipe(totps);
+        return FL_METHOD_RESPONSE(fl_method_error_response_new("encryptionError", "Unable to encrypt the TOTPs.", nullptr));
+    }
+
+    g_autoptr(FlValue) list = fl_value_new_list();
+    size_t index = 0;
+    for (const ImportedTotp& totp : totps) {
+        FlValue* value = fl_value_new_map();
+        fl_value_set_string_take(value, "secret", fl_value_new_string(totp.secret.c_str()));
+        fl_value_set_string_take(value, "label", fl_value_new_string(totp.label.c_str()));
+        fl_value_set_string_take(value, "issuer", totp.has_issuer ? fl_value_new_string(totp.issuer.c_str()) : fl_value_new_null());
+        fl_value_set_string_take(value, "algorithm", totp.algorithm.empty() ? fl_value_new_null() : fl_value_new_string(totp.algorithm.c_str()));
+        fl_value_set_string_take(value, "digits", totp.digits == 0 ? fl_value_new_null() : fl_value_new_int(totp.digits));
+        fl_value_set_string_take(value, "validity", totp.validity == 0 ? fl_value_new_null() : fl_value_new_int(totp.validity));
+        fl_value_set_string_take(value, "encryptedSecret", encrypted_value(encrypted[index++]));
+        fl_value_set_string_take(value, "encryptedLabel", encrypted_value(encrypted[index++]));
+        fl_value_set_string_take(value, "encryptedIssuer", totp.has_issuer ? encrypted_value(encrypted[index++]) : fl_value_new_null());
+        fl_value_append_take(list, value);
+    }
+    totp_import_wipe(totps);
+
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string(result, "totps", list);
+    fl_value_set_string_take(result, "rejected", fl_value_new_int(rejected));
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+static void runner_method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call, gpointer user_data) {
+    const gchar* method = fl_method_call_get_name(method_call);
+
+    g_autoptr(FlMethodResponse) response = nullptr;
+    if (strcmp(method, "runner.startupTrace") == 0) {
+        g_autoptr(FlValue) result = startup_trace_to_value();
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    } else if (strcmp(method, "trace.setEnabled") == 0) {
+        FlValue* args = fl_method_call_get_args(method_call);
+        trace_set_enabled(fl_value_get_type(args) == FL_VALUE_TYPE_BOOL && fl_value_get_bool(args));
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    } else if (strcmp(method, "trace.export") == 0) {
+        FlValue* args = fl_method_call_get_args(method_call);
+        gint64 clock_offset = fl_value_get_type(args) == FL_VALUE_TYPE_INT ? fl_value_get_int(args) : 0;
+        g_autoptr(FlValue) result = fl_value_new_string(trace_export_chrome_json(clock_offset).c_str());
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    } else if (strcmp(method, "trace.clear") == 0) {
+        trace_clear();
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    } else if (strcmp(method, "frames.report") == 0) {
+        g_autoptr(FlValue) result = frame_stats_to_value();
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    } else if (strcmp(method, "runner.memory") == 0) {
+        // Optionally takes {"samplingInterval": ms, "samplingPath": path}, an
+        // interval of 0 stopping the sampling.
+        FlValue* args = fl_method_call_get_args(method_call);
+        g_autoptr(FlValue) result = memory_stats_to_value();
+        FlValue* interval = fl_value_get_type(args) == FL_VALUE_TYPE_MAP ? fl_value_lookup_string(args, "samplingInterval") : nullptr;
+        if (interval != nullptr && fl_value_get_type(interval) == FL_VALUE_TYPE_INT) {
+            if (fl_value_get_int(interval) > 0) {
+                FlValue* path = fl_value_lookup_string(args, "samplingPath");
+                guint interval_ms = static_cast<guint>(MIN(fl_value_get_int(interval), static_cast<gint64>(G_MAXUINT)));
+                g_autofree gchar* sampling_path = memory_stats_start_sampling(interval_ms, path != nullptr && fl_value_get_type(path) == FL_VALUE_TYPE_STRING ? fl_value_get_string(path) : nullptr);
+                if (sampling_path != nullptr) {
+                    fl_value_set_string_take(result, "samplingPath", fl_value_new_string(sampling_path));
+                }
+            } else {
+                memory_stats_stop_sampling();
+            }
+        }
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    } else if (strcmp(method, "metrics.snapshot") == 0) {
+        g_autoptr(FlValue) result = fl_value_new_string(metrics::Registry::Get().SnapshotJson().c_str());
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    } else if (strcmp(method, "codesService.setKey") == 0) {
+        FlValue* args = fl_method_call_get_args(method_call);
+        if (fl_value_get_type(args) != FL_VALUE_TYPE_UINT8_LIST) {
+            response = FL_METHOD_RESPONSE(fl_method_error_response_new("invalidArgument", "The key must be a Uint8List.", nullptr));
+        } else {
+            const uint8_t* key = fl_value_get_uint8_list(args);
+            std::vector<uint8_t> key_copy(key, key + fl_value_get_length(args));
+            codes_service_set_key(key_copy);
+            vault_wipe(key_copy);
+            response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+        }
+    } else if (strcmp(method, "totps.import") == 0) {
+        FlValue* args = fl_method_call_get_args(method_call);
+        FlValue* text = fl_value_get_type(args) == FL_VALUE_TYPE_MAP ? fl_value_lookup_string(args, "text") : nullptr;
+        FlValue* key = fl_value_get_type(args) == FL_VALUE_TYPE_MAP ? fl_value_lookup_string(args, "key") : nullptr;
+        if (text == nullptr || fl_value_get_type(text) != FL_VALUE_TYPE_STRING || key == nullptr || fl_value_get_type(key) != FL_VALUE_TYPE_UINT8_LIST) {
+            response = FL_METHOD_RESPONSE(fl_method_error_response_new("invalidArgument", "Expected a text and a Uint8List key.", nullptr));
+        } else {
+            const uint8_t* key_data = fl_value_get_uint8_list(key);
+            std::vector<uint8_t> key_copy(key_data, key_data + fl_value_get_length(key));
+            response = import_totps(fl_value_get_string(text), key_copy);
+            vault_wipe(key_copy);
+        }
+    } else if (strcmp(method, "codesService.clearKey") == 0) {
+        codes_service_clear_key();
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    } else {
+        response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    }
+    fl_method_call_respond(method_call, response, nullptr);
+}
+
+static void first_frame_cb(FlView* view) {
+    startup_trace_first_frame();
+    prewarm_record_profile();
+}
+
 // Implements GApplication::activate.
 static void my_application_activate(GApplication* application) {
     MyApplication* self = MY_APPLICATION(application);
@@ -164,6 +328,11 @@ static void my_application_activate(GApplication* application) {
         return;
     }
 
+    TraceSpan span("activate");
+    gint64 activate_start = startup_trace_now();
+    prewarm_start();
+
+    gint64 phase_start = activate_start;
     GtkWindow* window =
             GTK_WINDOW(gtk_application_window_new(GTK_APPLICATION(application)));
 
@@ -196,24 +365,67 @@ static void my_application_activate(GApplication* application) {
 
     gtk_window_set_default_size(window, 1280, 720);
     gtk_widget_show(GTK_WIDGET(window));
+    startup_trace_add_phase("window", phase_start);
 
+    phase_start = startup_trace_now();
     g_autoptr(FlDartProject) project = fl_dart_project_new();
     fl_dart_project_set_dart_entrypoint_arguments(project, self->dart_entrypoint_arguments);
+    startup_trace_add_phase("project", phase_start);
 
+    phase_start = startup_trace_now();
     FlView* view = fl_view_new(project);
+    g_signal_connect(view, "first-frame", G_CALLBACK(first_frame_cb), nullptr);
+    frame_stats_attach(GTK_WIDGET(view));
     gtk_widget_show(GTK_WIDGET(view));
     gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(view));
+    startup_trace_add_phase("view", phase_start);
 
+    phase_start = startup_trace_now();
     fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+    startup_trace_add_phase("plugins", phase_start);
 
+    phase_start = startup_trace_now();
     FlEngine* engine = fl_view_get_engine(view);
 
     g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
     g_autoptr(FlBinaryMessenger) messenger = fl_engine_get_binary_messenger(engine);
     g_autoptr(FlMethodChannel) channel = fl_method_channel_new(messenger, "app.openauthenticator.localauth", FL_METHOD_CODEC(codec));
     fl_method_channel_set_method_call_handler(channel, method_call_cb, g_object_ref(view), g_object_unref);
+    self->runner_channel = fl_method_channel_new(messenger, "app.openauthenticator.runner", FL_METHOD_CODEC(codec));
+    fl_method_channel_set_method_call_handler(self->runner_channel, runner_method_call_cb, g_object_ref(view), g_object_unref);
+    startup_trace_add_phase("channels", phase_start);
+
+    // Lets leaks be bisected from the very start of a session. Anything but a
+    // positive number of milliseconds leaves sampling disabled.
+    const gchar* sampling_interval = g_getenv("OPENAUTH_MEMORY_SAMPLING");
+    if (sampling_interval != nullptr && g_ascii_isdigit(sampling_interval[0])) {
+        gchar* end = nullptr;
+        guint64 interval_ms = g_ascii_strtoull(sampling_interval, &end, 10);
+        if (*end == '\0' && interval_ms > 0) {
+            g_free(memory_stats_start_sampling(static_cast<guint>(MIN(interval_ms, static_cast<guint64>(G_MAXUINT))), nullptr));
+        }
+    }
 
     gtk_widget_grab_focus(GTK_WIDGET(view));
+    startup_trace_add_phase("activate", activate_start);
+}
+
+// Implements GApplication::open. The links themselves reach Dart through
+// app_links, whose GTK plugin handles the "open" signal too.
+static void my_application_open(GApplication* application, GFile** files, gint n_files, const gchar* hint) {
+    g_application_activate(application);
+}
+
+// Returns the otpauth:// URIs passed on the command line, if any.
+static GPtrArray* get_otpauth_uris(gchar** arguments) {
+    GPtrArray* files = g_ptr_array_new_with_free_func(g_object_unref);
+    for (gchar** argument = arguments; *argument != nullptr; argument++) {
+        g_autofree gchar* scheme = g_uri_parse_scheme(*argument);
+        if (g_strcmp0(scheme, "otpauth") == 0 || g_strcmp0(scheme, "otpauth-migration") == 0) {
+            g_ptr_array_add(files, g_file_new_for_uri(*argument));
+        }
+    }
+    return files;
 }
 
 // Implements GApplication::local_command_line.
@@ -223,11 +435,22 @@ static gboolean my_application_local_command_line(GApplication* application, gch
     self->dart_entrypoint_arguments = g_strdupv(*arguments + 1);
 
     g_autoptr(GError) error = nullptr;
+    gint64 register_start = startup_trace_now();
     if (!g_application_register(application, nullptr, &error)) {
         g_warning("Failed to register: %s", error->message);
         *exit_status = 1;
         return TRUE;
     }
+    startup_trace_add_phase("register", register_start);
+
+    // Another instance is running : hand it the links and exit, without
+    // starting an engine of our own.
+    g_autoptr(GPtrArray) uris = get_otpauth_uris(self->dart_entrypoint_arguments);
+    if (g_application_get_is_remote(application) && uris->len > 0) {
+        g_application_open(application, reinterpret_cast<GFile**>(uris->pdata), uris->len, "");
+        *exit_status = 0;
+        return TRUE;
+    }
 
     g_application_activate(application);
     *exit_status = 0;
@@ -235,15 +458,35 @@ static gboolean my_application_local_command_line(GApplication* application, gch
     return FALSE;
 }
 
+// Implements GApplication::dbus_register.
+static gboolean my_application_dbus_register(GApplication* application, GDBusConnection* connection, const gchar* object_path, GError** error) {
+    if (!G_APPLICATION_CLASS(my_application_parent_class)->dbus_register(application, connection, object_path, error)) {
+        return FALSE;
+    }
+    return codes_service_register(connection, object_path, error);
+}
+
+// Implements GApplication::dbus_unregister.
+static void my_application_dbus_unregister(GApplication* application, GDBusConnection* connection, const gchar* object_path) {
+    codes_service_unregister(connection);
+    codes_service_clear_key();
+    G_APPLICATION_CLASS(my_application_parent_class)->dbus_unregister(application, connection, object_path);
+}
+
 // Implements GObject::dispose.
 static void my_application_dispose(GObject* object) {
     MyApplication* self = MY_APPLICATION(object);
     g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
+    g_clear_object(&self->runner_channel);
+    memory_stats_stop_sampling();
     G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
 }
 
 static void my_application_class_init(MyApplicationClass* klass) {
     G_APPLICATION_CLASS(klass)->activate = my_application_activate;
+    G_APPLICATION_CLASS(klass)->open = my_application_open;
+    G_APPLICATION_CLASS(klass)->dbus_register = my_application_dbus_register;
+    G_APPLICATION_CLASS(klass)->dbus_unregister = my_application_dbus_unregister;
     G_APPLICATION_CLASS(klass)->local_command_line = my_application_local_command_line;
     G_OBJECT_CLASS(klass)->dispose = my_application_dispose;
 }
@@ -0,0 +1,264 @@
+#include "prewarm.h"
+
+#include <fcntl.h>
+#include <glib.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+// The files the engine reads during startup, relative to the bundle directory
+// (see the install rules of CMakeLists.txt). Directories are read recursively.
+static const gchar* const bundle_files[] = {
+    "lib/libapp.so",
+    "lib/libflutter_linux_gtk.so",
+    "data/icudtl.dat",
+    "data/flutter_assets",
+};
+
+// The engine library, which is already mapped by the time we run.
+static const gchar* const engine_library = "libflutter_linux_gtk.so";
+
+struct PrewarmRange {
+    std::string path;
+    off_t offset;
+    // 0 means up to the end of the file.
+    off_t length;
+    // The size and modification time of the file when the profile was
+    // recorded, so that the ranges of a file that has changed since (eg. after
+    // an update) aren't used.
+    off_t file_size;
+    gint64 file_mtime;
+};
+
+static gboolean is_recording() {
+    return g_getenv("OPENAUTH_PREWARM_RECORD") != nullptr;
+}
+
+static gchar* get_bundle_dir() {
+    g_autofree gchar* executable = g_file_read_link("/proc/self/exe", nullptr);
+    return executable == nullptr ? nullptr : g_path_get_dirname(executable);
+}
+
+static gchar* get_profile_path() {
+    return g_build_filename(g_get_user_cache_dir(), APPLICATION_ID, "prewarm_profile", nullptr);
+}
+
+static gint64 get_mtime(const struct stat& st) {
+    return static_cast<gint64>(st.st_mtim.tv_sec) * G_GINT64_CONSTANT(1000000000) + st.st_mtim.tv_nsec;
+}
+
+static void list_files(const gchar* bundle_dir, const gchar* relative_path, std::vector<std::string>& files) {
+    g_autofree gchar* path = g_build_filename(bundle_dir, relative_path, nullptr);
+    if (!g_file_test(path, G_FILE_TEST_IS_DIR)) {
+        if (g_file_test(path, G_FILE_TEST_IS_REGULAR)) {
+            files.push_back(relative_path);
+        }
+        return;
+    }
+    GDir* dir = g_dir_open(path, 0, nullptr);
+    if (dir == nullptr) {
+        return;
+    }
+    while (const gchar* name = g_dir_read_name(dir)) {
+        g_autofree gchar* child = g_build_filename(relative_path, name, nullptr);
+        list_files(bundle_dir, child, files);
+    }
+    g_dir_close(dir);
+}
+
+// Reads the ranges of a page access profile, or returns false if there is none.
+// Each line is a range: the path of its file, the size and modification time
+// of the file, then the offset and length of the range.
+static bool read_profile(std::vector<PrewarmRange>& ranges) {
+    g_autofree gchar* profile_path = get_profile_path();
+    g_autofree gchar* contents = nullptr;
+    if (!g_file_get_contents(profile_path, &contents, nullptr, nullptr)) {
+        return false;
+    }
+    g_auto(GStrv) lines = g_strsplit(contents, "\n", -1);
+    for (gchar** line = lines; *line != nullptr; line++) {
+        g_auto(GStrv) fields = g_strsplit(*line, "\t", 5);
+        if (g_strv_length(fields) != 5 || strstr(fields[0], "..") != nullptr) {
+            continue;
+        }
+        ranges.push_back({fields[0], static_cast<off_t>(g_ascii_strtoll(fields[3], nullptr, 10)), static_cast<off_t>(g_ascii_strtoll(fields[4], nullptr, 10)), static_cast<off_t>(g_ascii_strtoll(fields[1], nullptr, 10)), g_ascii_strtoll(fields[2], nullptr, 10)});
+    }
+    // Profiles recorded in an older format are recorded again.
+    return !ranges.empty();
+}
+
+// Replaces the ranges of the files that have changed since the profile was
+// recorded by their whole file, as without a profile.
+static void remove_stale_ranges(const gchar* bundle_dir, std::vector<PrewarmRange>& ranges) {
+    std::set<std::string> checked_files;
+    std::set<std::string> stale_files;
+    for (const PrewarmRange& range : ranges) {
+        if (!checked_files.insert(range.path).second) {
+            continue;
+        }
+        g_autofree gchar* path = g_build_filename(bundle_dir, range.path.c_str(), nullptr);
+        struct stat st;
+        if (stat(path, &st) != 0 || st.st_size != range.file_size || get_mtime(st) != range.file_mtime) {
+            stale_files.insert(range.path);
+        }
+    }
+    if (stale_files.empty()) {
+        return;
+    }
+    std::vector<PrewarmRange> valid_ranges;
+    for (PrewarmRange& range : ranges) {
+        if (stale_files.count(range.path) == 0) {
+            valid_ranges.push_back(std::move(range));
+        }
+    }
+    for (const std::string& file : stale_files) {
+        valid_ranges.push_back({file, 0, 0, 0, 0});
+    }
+    ranges.swap(valid_ranges);
+}
+
+static void prewarm_range(const gchar* bundle_dir, const PrewarmRange& range) {
+    g_autofree gchar* path = g_build_filename(bundle_dir, range.path.c_str(), nullptr);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    off_t length = range.length;
+    struct stat st;
+    if (length == 0 && fstat(fd, &st) == 0) {
+        length = st.st_size;
+    }
+    // readahead() blocks until the pages are read, which is what we want on a
+    // background thread, but isn't supported by every file system.
+    if (readahead(fd, range.offset, length) != 0) {
+        posix_fadvise(fd, range.offset, length, POSIX_FADV_WILLNEED);
+    }
+    close(fd);
+}
+
+// Asks the kernel to fault in the segments of the engine library, which has
+// been mapped by the dynamic loader.
+static int prewarm_engine_library(struct dl_phdr_info* info, size_t size, void* data) {
+    if (info->dlpi_name == nullptr || !g_str_has_suffix(info->dlpi_name, engine_library)) {
+        return 0;
+    }
+    uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    for (ElfW(Half) i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr)& header = info->dlpi_phdr[i];
+        if (header.p_type != PT_LOAD) {
+            continue;
+        }
+        uintptr_t start = (info->dlpi_addr + header.p_vaddr) & ~(page_size - 1);
+        uintptr_t end = info->dlpi_addr + header.p_vaddr + header.p_memsz;
+        madvise(reinterpret_cast<void*>(start), end - start, MADV_WILLNEED);
+    }
+    return 1;
+}
+
+static gpointer prewarm_thread(gpointer user_data) {
+    g_autofree gchar* bundle_dir = get_bundle_dir();
+    if (bundle_dir == nullptr) {
+        return nullptr;
+    }
+    dl_iterate_phdr(prewarm_engine_library, nullptr);
+
+    std::vector<PrewarmRange> ranges;
+    if (read_profile(ranges)) {
+        remove_stale_ranges(bundle_dir, ranges);
+    } else {
+        std::vector<std::string> files;
+        for (const gchar* file : bundle_files) {
+            list_files(bundle_dir, file, files);
+        }
+        for (const std::string& file : files) {
+            ranges.push_back({file, 0, 0, 0, 0});
+        }
+    }
+    for (const PrewarmRange& range : ranges) {
+        prewarm_range(bundle_dir, range);
+    }
+    return nullptr;
+}
+
+// Appends the ranges of the file that are in the page cache to the profile.
+static void record_file(const gchar* bundle_dir, const std::string& file, GString* profile) {
+    g_autofree gchar* path = g_build_filename(bundle_dir, file.c_str(), nullptr);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return;
+    }
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t page_count = (st.st_size + page_size - 1) / page_size;
+    std::vector<unsigned char> residency(page_count);
+    if (mincore(mapping, st.st_size, residency.data()) == 0) {
+        size_t page = 0;
+        while (page < page_count) {
+            if (!(residency[page] & 1)) {
+                page++;
+                continue;
+            }
+            size_t first = page;
+            while (page < page_count && (residency[page] & 1)) {
+                page++;
+            }
+            g_string_append_printf(profile, "%s\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%zu\t%zu\n", file.c_str(), static_cast<gint64>(st.st_size), get_mtime(st), first * page_size, (page - first) * page_size);
+        }
+    }
+    munmap(mapping, st.st_size);
+}
+
+static gpointer record_profile_thread(gpointer user_data) {
+    g_autofree gchar* bundle_dir = get_bundle_dir();
+    if (bundle_dir == nullptr) {
+        return nullptr;
+    }
+    std::vector<std::string> files;
+    for (const gchar* file : bundle_files) {
+        list_files(bundle_dir, file, files);
+    }
+    GString* profile = g_string_new(nullptr);
+    for (const std::string& file : files) {
+        record_file(bundle_dir, file, profile);
+    }
+
+    g_autofree gchar* profile_path = get_profile_path();
+    g_autofree gchar* profile_dir = g_path_get_dirname(profile_path);
+    g_mkdir_with_parents(profile_dir, 0700);
+    g_autoptr(GError) error = nullptr;
+    if (!g_file_set_contents(profile_path, profile->str, profile->len, &error)) {
+        g_warning("Failed to write the prewarm profile to %s: %s", profile_path, error->message);
+    }
+    g_string_free(profile, TRUE);
+    return nullptr;
+}
+
+void prewarm_start() {
+    // Prewarming would fill the page cache, and the profile with it.
+    if (is_recording()) {
+        return;
+    }
+    g_thread_unref(g_thread_new("prewarm", prewarm_thread, nullptr));
+}
+
+void prewarm_record_profile() {
+    if (!is_recording()) {
+        return;
+    }
+    g_thread_unref(g_thread_new("prewarm-record", record_profile_thread, nullptr));
+}
@@ -0,0 +1,25 @@
+#ifndef FLUTTER_PREWARM_H_
+#define FLUTTER_PREWARM_H_
+
+/**
+ * prewarm_start:
+ *
+ * Starts reading the AOT snapshot, the Flutter engine and its assets into the
+ * page cache on a background thread, so that the engine doesn't wait for
+ * them page fault after page fault. If a page access profile has been
+ * recorded, only the pages it contains are read.
+ */
+void prewarm_start();
+
+/**
+ * prewarm_record_profile:
+ *
+ * Records which pages of the bundle files are in the page cache to the page
+ * access profile, on a background thread. Only does something if
+ * `OPENAUTH_PREWARM_RECORD` is set, in which case prewarm_start() does
+ * nothing. Should be called after the first frame, preferably after dropping
+ * the page cache before launching the application.
+ */
+void prewarm_record_profile();
+
+#endif  // FLUTTER_PREWARM_H_
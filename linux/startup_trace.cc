@@ -0,0 +1,96 @@
+#include "startup_trace.h"
+
+#include <unistd.h>
+
+// The maximum number of phases we record.
+static const size_t kMaxStartupPhases = 32;
+
+struct StartupPhase {
+    const gchar* name;
+    gint64 start;
+    gint64 end;
+};
+
+// Only accessed from the main thread.
+static gint64 main_time = 0;
+static gint64 first_frame_time = 0;
+static StartupPhase phases[kMaxStartupPhases];
+static size_t phase_count = 0;
+
+void startup_trace_start() {
+    main_time = startup_trace_now();
+}
+
+gint64 startup_trace_now() {
+    return g_get_monotonic_time();
+}
+
+void startup_trace_add_phase(const gchar* name, gint64 start) {
+    if (phase_count == kMaxStartupPhases) {
+        return;
+    }
+    phases[phase_count++] = {name, start, startup_trace_now()};
+}
+
+static gchar* startup_trace_get_path() {
+    const gchar* value = g_getenv("OPENAUTH_TRACE_STARTUP");
+    if (value == nullptr || *value == '\0' || g_strcmp0(value, "0") == 0) {
+        return nullptr;
+    }
+    if (g_strcmp0(value, "1") != 0) {
+        return g_strdup(value);
+    }
+    g_autofree gchar* directory = g_build_filename(g_get_user_cache_dir(), APPLICATION_ID, nullptr);
+    g_mkdir_with_parents(directory, 0700);
+    return g_build_filename(directory, "startup_trace.json", nullptr);
+}
+
+// Writes the recorded phases using the Chrome trace event format, which
+// Perfetto opens as well.
+static void startup_trace_write(const gchar* path) {
+    int pid = getpid();
+    GString* json = g_string_new("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    g_string_append_printf(json, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", pid, pid, g_get_prgname());
+    g_string_append_printf(json, ",{\"name\":\"startup\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%d}", main_time, first_frame_time - main_time, pid, pid);
+    for (size_t i = 0; i < phase_count; i++) {
+        const StartupPhase& phase = phases[i];
+        g_string_append_printf(json, ",{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%d}", phase.name, phase.start, phase.end - phase.start, pid, pid);
+    }
+    g_string_append_printf(json, ",{\"name\":\"firstFrame\",\"cat\":\"startup\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%d}]}\n", first_frame_time, pid, pid);
+
+    g_autoptr(GError) error = nullptr;
+    if (!g_file_set_contents(path, json->str, json->len, &error)) {
+        g_warning("Failed to write the startup trace to %s: %s", path, error->message);
+    }
+    g_string_free(json, TRUE);
+}
+
+void startup_trace_first_frame() {
+    if (first_frame_time != 0) {
+        return;
+    }
+    first_frame_time = startup_trace_now();
+    g_autofree gchar* path = startup_trace_get_path();
+    if (path != nullptr) {
+        startup_trace_write(path);
+    }
+}
+
+FlValue* startup_trace_to_value() {
+    FlValue* result = fl_value_new_map();
+    FlValue* list = fl_value_new_list();
+    for (size_t i = 0; i < phase_count; i++) {
+        const StartupPhase& phase = phases[i];
+        FlValue* value = fl_value_new_map();
+        fl_value_set_string_take(value, "name", fl_value_new_string(phase.name));
+        fl_value_set_string_take(value, "start", fl_value_new_int(phase.start - main_time));
+        fl_value_set_string_take(value, "end", fl_value_new_int(phase.end - main_time));
+        fl_value_append_take(list, value);
+    }
+    // All times are in microseconds, relative to the start of main, except for
+    // this one, which allows to correlate them with other monotonic timestamps.
+    fl_value_set_string_take(result, "main", fl_value_new_int(main_time));
+    fl_value_set_string_take(result, "firstFrame", first_frame_time == 0 ? fl_value_new_null() : fl_value_new_int(first_frame_time - main_time));
+    fl_value_set_string_take(result, "phases", list);
+    return result;
+}
@@ -0,0 +1,46 @@
+#ifndef FLUTTER_STARTUP_TRACE_H_
+#define FLUTTER_STARTUP_TRACE_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+/**
+ * startup_trace_start:
+ *
+ * Starts tracing the application startup. Should be the first thing called by
+ * `main`, as every phase is relative to this call.
+ */
+void startup_trace_start();
+
+/**
+ * startup_trace_now:
+ *
+ * Returns: the current time, in microseconds of the monotonic clock.
+ */
+gint64 startup_trace_now();
+
+/**
+ * startup_trace_add_phase:
+ * @name: the phase name, which must be a static string.
+ * @start: when the phase has started, as returned by startup_trace_now().
+ *
+ * Records a startup phase that ends now. Must be called on the main thread.
+ */
+void startup_trace_add_phase(const gchar* name, gint64 start);
+
+/**
+ * startup_trace_first_frame:
+ *
+ * Records the first frame, which ends the startup. If `OPENAUTH_TRACE_STARTUP`
+ * is set, the trace is then written to the path it contains, or to the user
+ * cache directory if it's set to `1`.
+ */
+void startup_trace_first_frame();
+
+/**
+ * startup_trace_to_value:
+ *
+ * Returns: the recorded phases, as a map that can be sent to Dart.
+ */
+FlValue* startup_trace_to_value();
+
+#endif  // FLUTTER_STARTUP_TRACE_H_
@@ -0,0 +1,43 @@
+#ifndef FLUTTER_TEST_TEST_H_
+#define FLUTTER_TEST_TEST_H_
+
+// Minimal assertions for the runner tests, so that they don't need a test
+// framework. A failed expectation is reported, and makes test_exit_code()
+// return a failure, but the test keeps running. Each test is a single
+// translation unit, which owns its failure count.
+
+#include <iostream>
+
+static int test_failures = 0;
+
+#define EXPECT(condition)                                                     \
+    do {                                                                      \
+        if (!(condition)) {                                                   \
+            test_failures++;                                                  \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": expected " #condition \
+                      << std::endl;                                           \
+        }                                                                     \
+    } while (false)
+
+#define EXPECT_EQ(actual, expected)                                           \
+    do {                                                                      \
+        auto actual_value = (actual);                                         \
+        auto expected_value = (expected);                                     \
+        if (!(actual_value == expected_value)) {                              \
+            test_failures++;                                                  \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": expected " #actual \
+                      << " == " << expected_value << ", got " << actual_value \
+                      << std::endl;                                           \
+        }                                                                     \
+    } while (false)
+
+// Returns the exit code of the test: non-zero if an expectation failed.
+static inline int test_exit_code() {
+    if (test_failures > 0) {
+        std::cerr << test_failures << " expectation(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#endif  // FLUTTER_TEST_TEST_H_
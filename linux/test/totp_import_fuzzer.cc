@@ -0,0 +1,52 @@
+#include "totp_import.h"
+
+#include <glib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// Parses arbitrary text. Migration payloads are only reached through valid
+// base64, so inputs starting with a 'm' are encoded as one first.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string text;
+    if (size > 0 && data[0] == 'm') {
+        g_autofree gchar* payload = g_base64_encode(data + 1, size - 1);
+        text = std::string("otpauth-migration://offline?data=") + payload;
+    } else {
+        text.assign(reinterpret_cast<const char*>(data), size);
+    }
+    std::vector<ImportedTotp> totps;
+    totp_import_parse(text, totps);
+    totp_import_wipe(totps);
+    return 0;
+}
+
+#ifdef RUNNER_TEST_REPLAY
+#include <random>
+
+// Without libFuzzer, replays random inputs biased towards the bytes that
+// start protobuf fields and the characters that delimit URIs.
+int main() {
+    static const char protobuf_bytes[] = "\x0a\x12\x08\x22\x20\x28\x30";
+    static const char uri_characters[] = "%&=?#/+aZ27 A\n";
+    std::mt19937 random(1);
+    for (int i = 0; i < 200000; i++) {
+        std::string input;
+        if (i % 3 == 0) {
+            input = "otpauth://totp/";
+            for (int length = random() % 40; length > 0; length--) {
+                input.push_back(uri_characters[random() % (sizeof(uri_characters) - 1)]);
+            }
+        } else {
+            input = "m";
+            for (int length = random() % 64; length > 0; length--) {
+                input.push_back(random() % 4 == 0 ? protobuf_bytes[random() % (sizeof(protobuf_bytes) - 1)] : static_cast<char>(random()));
+            }
+        }
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    }
+    return 0;
+}
+#endif
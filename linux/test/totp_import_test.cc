@@ -0,0 +1,164 @@
+#include "totp_import.h"
+
+#include <glib.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "test.h"
+#include "vault.h"
+
+static std::string encode_varint(uint64_t value) {
+    std::string result;
+    while (value >= 0x80) {
+        result.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    result.push_back(static_cast<char>(value));
+    return result;
+}
+
+static std::string encode_bytes_field(uint64_t number, const std::string& value) {
+    return encode_varint(number << 3 | 2) + encode_varint(value.size()) + value;
+}
+
+static std::string encode_varint_field(uint64_t number, uint64_t value) {
+    return encode_varint(number << 3) + encode_varint(value);
+}
+
+static std::string encode_base64(const std::string& data) {
+    g_autofree gchar* encoded = g_base64_encode(reinterpret_cast<const guchar*>(data.data()), data.size());
+    return encoded;
+}
+
+static std::string percent_encode(const std::string& text) {
+    g_autofree gchar* escaped = g_uri_escape_string(text.c_str(), nullptr, FALSE);
+    return escaped;
+}
+
+// A `MigrationPayload` with a SHA-1 account using the defaults, a SHA-512
+// account with 8 digits, and a HOTP account, which isn't supported.
+static std::string make_migration_payload() {
+    std::string sha1_account = encode_bytes_field(1, "12345678901234567890") + encode_bytes_field(2, "alice@google.com") + encode_bytes_field(3, "Google") +
+        encode_varint_field(4, 1) + encode_varint_field(5, 1) + encode_varint_field(6, 2);
+    std::string sha512_account = encode_bytes_field(1, std::string("\x01\x02\x03", 3)) + encode_bytes_field(2, "bob") + encode_varint_field(4, 3) +
+        encode_varint_field(5, 2) + encode_varint_field(6, 2);
+    std::string hotp_account = encode_bytes_field(1, "hotp") + encode_bytes_field(2, "h") + encode_varint_field(6, 1);
+    // Followed by the version, batch size, batch index and batch ID.
+    return encode_bytes_field(1, sha1_account) + encode_bytes_field(1, sha512_account) + encode_bytes_field(1, hotp_account) +
+        encode_varint_field(2, 1) + encode_varint_field(3, 1) + encode_varint_field(4, 0) + encode_varint_field(5, 12345);
+}
+
+static void test_otpauth_uri() {
+    std::vector<ImportedTotp> totps;
+    int rejected = totp_import_parse("otpauth://totp/Example:alice%40google.com?secret=jbsw-y3dp+ehpk3pxp&issuer=Ex+ample&algorithm=SHA256&digits=8&period=60", totps);
+    EXPECT_EQ(rejected, 0);
+    EXPECT_EQ(totps.size(), 1u);
+    if (totps.size() == 1) {
+        EXPECT_EQ(totps[0].secret, "JBSWY3DPEHPK3PXP");
+        EXPECT_EQ(totps[0].label, "Example:alice@google.com");
+        EXPECT(totps[0].has_issuer);
+        EXPECT_EQ(totps[0].issuer, "Ex ample");
+        EXPECT_EQ(totps[0].algorithm, "sha256");
+        EXPECT_EQ(totps[0].digits, 8);
+        EXPECT_EQ(totps[0].validity, 60);
+    }
+    totp_import_wipe(totps);
+}
+
+static void test_otpauth_uri_defaults() {
+    std::vector<ImportedTotp> totps;
+    int rejected = totp_import_parse(" otpauth://TOTP/y?issuer=I&secret=JBSWY3DPEHPK3PXP=&digits=0&algorithm=md5#fragment\n", totps);
+    EXPECT_EQ(rejected, 0);
+    EXPECT_EQ(totps.size(), 1u);
+    if (totps.size() == 1) {
+        EXPECT_EQ(totps[0].secret, "JBSWY3DPEHPK3PXP");
+        EXPECT_EQ(totps[0].label, "y");
+        EXPECT_EQ(totps[0].issuer, "I");
+        EXPECT(totps[0].algorithm.empty());
+        EXPECT_EQ(totps[0].digits, 0);
+        EXPECT_EQ(totps[0].validity, 0);
+    }
+    totp_import_wipe(totps);
+}
+
+static void test_rejected_uris() {
+    static const char* const uris[] = {
+        // Not base32.
+        "otpauth://totp/x?secret=ABC1",
+        // Would leave a partial byte.
+        "otpauth://totp/x?secret=JBSWY3",
+        "otpauth://totp/x?issuer=NoSecret",
+        "otpauth://hotp/x?secret=JBSWY3DP",
+        "https://example.com",
+        "otpauth-migration://online?data=CgA%3D",
+        "otpauth-migration://offline?data=",
+        // A truncated varint.
+        "otpauth-migration://offline?data=CP8%3D",
+    };
+    for (const char* uri : uris) {
+        std::vector<ImportedTotp> totps;
+        int rejected = totp_import_parse(uri, totps);
+        if (rejected != 1 || !totps.empty()) {
+            std::cerr << "accepted " << uri << std::endl;
+        }
+        EXPECT_EQ(rejected, 1);
+        EXPECT(totps.empty());
+    }
+}
+
+static void test_migration_uri() {
+    std::string payload = encode_base64(make_migration_payload());
+    // Exports percent-encode their payload, but a pasted one may not be.
+    std::string text = "otpauth-migration://offline?data=" + percent_encode(payload) + "\notpauth-migration://offline?data=" + payload;
+    std::vector<ImportedTotp> totps;
+    int rejected = totp_import_parse(text, totps);
+    // The HOTP account of each URI.
+    EXPECT_EQ(rejected, 2);
+    EXPECT_EQ(totps.size(), 4u);
+    for (size_t i = 0; i + 1 < totps.size(); i += 2) {
+        EXPECT_EQ(totps[i].secret, "GEZDGNBVGY3TQOJQGEZDGNBVGY3TQOJQ");
+        EXPECT_EQ(totps[i].label, "alice@google.com");
+        EXPECT(totps[i].has_issuer);
+        EXPECT_EQ(totps[i].issuer, "Google");
+        EXPECT(totps[i].algorithm.empty());
+        EXPECT_EQ(totps[i].digits, 0);
+
+        EXPECT_EQ(totps[i + 1].secret, "AEBAG");
+        EXPECT_EQ(totps[i + 1].label, "bob");
+        EXPECT(!totps[i + 1].has_issuer);
+        EXPECT_EQ(totps[i + 1].algorithm, "sha512");
+        EXPECT_EQ(totps[i + 1].digits, 8);
+    }
+    totp_import_wipe(totps);
+}
+
+static void test_encrypts_imported_secrets() {
+    std::vector<ImportedTotp> totps;
+    totp_import_parse("otpauth://totp/a?secret=JBSWY3DPEHPK3PXP otpauth://totp/b?secret=GEZDGNBVGY3TQOJQ", totps);
+    EXPECT_EQ(totps.size(), 2u);
+    std::vector<uint8_t> key(32, 7);
+    std::vector<const std::string*> texts;
+    for (const ImportedTotp& totp : totps) {
+        texts.push_back(&totp.secret);
+    }
+    std::vector<std::vector<uint8_t>> encrypted;
+    EXPECT(vault_encrypt(key, texts, encrypted));
+    EXPECT_EQ(encrypted.size(), totps.size());
+    for (size_t i = 0; i < encrypted.size() && i < totps.size(); i++) {
+        std::string decrypted;
+        EXPECT(vault_decrypt(key, encrypted[i], decrypted));
+        EXPECT_EQ(decrypted, totps[i].secret);
+    }
+    totp_import_wipe(totps);
+}
+
+int main() {
+    test_otpauth_uri();
+    test_otpauth_uri_defaults();
+    test_rejected_uris();
+    test_migration_uri();
+    test_encrypts_imported_secrets();
+    return test_exit_code();
+}
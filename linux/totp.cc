@@ -0,0 +1,80 @@
+#include "totp.h"
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+bool totp_decode_base32(const std::string& secret, std::vector<uint8_t>& key) {
+    key.clear();
+    key.reserve(secret.size() * 5 / 8);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : secret) {
+        int value;
+        if (c >= 'A' && c <= 'Z') {
+            value = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            value = c - 'a';
+        } else if (c >= '2' && c <= '7') {
+            value = c - '2' + 26;
+        } else if (c == ' ' || c == '-' || c == '=') {
+            continue;
+        } else {
+            return false;
+        }
+        buffer = (buffer << 5) | value;
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            key.push_back(static_cast<uint8_t>(buffer >> bits));
+        }
+    }
+    return !key.empty();
+}
+
+std::string totp_encode_base32(const uint8_t* key, size_t length) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+    std::string result;
+    result.reserve((length * 8 + 4) / 5);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (size_t i = 0; i < length; i++) {
+        buffer = (buffer << 8) | key[i];
+        bits += 8;
+        while (bits >= 5) {
+            bits -= 5;
+            result.push_back(alphabet[(buffer >> bits) & 0x1f]);
+        }
+    }
+    if (bits > 0) {
+        result.push_back(alphabet[(buffer << (5 - bits)) & 0x1f]);
+    }
+    return result;
+}
+
+std::string totp_generate_code(const std::vector<uint8_t>& key, const std::string& algorithm, int digits, int validity, time_t now) {
+    const EVP_MD* md = algorithm == "sha1" ? EVP_sha1() : (algorithm == "sha256" ? EVP_sha256() : (algorithm == "sha512" ? EVP_sha512() : nullptr));
+    if (md == nullptr || digits <= 0 || digits > 9 || validity <= 0 || now < 0) {
+        return std::string();
+    }
+
+    uint64_t counter = static_cast<uint64_t>(now) / validity;
+    uint8_t message[8];
+    for (int i = 7; i >= 0; i--) {
+        message[i] = static_cast<uint8_t>(counter);
+        counter >>= 8;
+    }
+    uint8_t hash[EVP_MAX_MD_SIZE];
+    unsigned int hash_length = 0;
+    if (HMAC(md, key.data(), static_cast<int>(key.size()), message, sizeof(message), hash, &hash_length) == nullptr) {
+        return std::string();
+    }
+
+    int offset = hash[hash_length - 1] & 0x0f;
+    uint32_t binary = (static_cast<uint32_t>(hash[offset] & 0x7f) << 24) | (static_cast<uint32_t>(hash[offset + 1]) << 16) | (static_cast<uint32_t>(hash[offset + 2]) << 8) | hash[offset + 3];
+    uint32_t modulo = 1;
+    for (int i = 0; i < digits; i++) {
+        modulo *= 10;
+    }
+    std::string code = std::to_string(binary % modulo);
+    return std::string(digits - code.size(), '0') + code;
+}
@@ -0,0 +1,45 @@
+#ifndef FLUTTER_TOTP_H_
+#define FLUTTER_TOTP_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+// The defaults used by the app when a TOTP doesn't specify them.
+static const char* const kTotpDefaultAlgorithm = "sha1";
+static const int kTotpDefaultDigits = 6;
+static const int kTotpDefaultValidity = 30;
+
+/**
+ * totp_decode_base32:
+ * @secret: the base32 secret. Case, spaces, dashes and padding are ignored.
+ * @key: where to write the decoded key.
+ *
+ * Returns: whether @secret is valid base32.
+ */
+bool totp_decode_base32(const std::string& secret, std::vector<uint8_t>& key);
+
+/**
+ * totp_encode_base32:
+ * @key: the key to encode.
+ * @length: the length of @key.
+ *
+ * Returns: @key, as unpadded uppercase base32.
+ */
+std::string totp_encode_base32(const uint8_t* key, size_t length);
+
+/**
+ * totp_generate_code:
+ * @key: the decoded secret.
+ * @algorithm: `sha1`, `sha256` or `sha512`.
+ * @digits: the number of digits of the code.
+ * @validity: the validity period, in seconds.
+ * @now: the time to generate the code for.
+ *
+ * Returns: the code, or an empty string if the parameters are invalid.
+ */
+std::string totp_generate_code(const std::vector<uint8_t>& key, const std::string& algorithm, int digits, int validity, time_t now);
+
+#endif  // FLUTTER_TOTP_H_
@@ -0,0 +1,356 @@
+#include "totp_import.h"
+
+#include <glib.h>
+#include <stdint.h>
+
+#include <cstring>
+#include <utility>
+
+#include "totp.h"
+#include "vault.h"
+
+// A slice of the imported text, so that URIs are read without being copied.
+struct Range {
+    const char* begin;
+    const char* end;
+};
+
+// A field of a protocol buffers message, see
+// https://protobuf.dev/programming-guides/encoding/. Length-delimited values
+// point into the message.
+struct ProtobufField {
+    uint64_t number;
+    int wire_type;
+    uint64_t varint;
+    const uint8_t* data;
+    size_t length;
+};
+
+// The enums of Google Authenticator `OtpParameters`.
+static const uint64_t kMigrationAlgorithmSha1 = 1;
+static const uint64_t kMigrationAlgorithmSha256 = 2;
+static const uint64_t kMigrationAlgorithmSha512 = 3;
+static const uint64_t kMigrationDigitsSix = 1;
+static const uint64_t kMigrationDigitsEight = 2;
+static const uint64_t kMigrationTypeHotp = 1;
+
+static bool starts_with(Range range, const char* prefix) {
+    size_t length = strlen(prefix);
+    return static_cast<size_t>(range.end - range.begin) >= length && g_ascii_strncasecmp(range.begin, prefix, length) == 0;
+}
+
+static bool equals(Range range, const char* text) {
+    return static_cast<size_t>(range.end - range.begin) == strlen(text) && starts_with(range, text);
+}
+
+static const char* find(Range range, const char* characters) {
+    for (const char* position = range.begin; position < range.end; position++) {
+        if (strchr(characters, *position) != nullptr) {
+            return position;
+        }
+    }
+    return range.end;
+}
+
+// Appends @range to @result, decoding percent-encoded characters. Query
+// parameters also encode spaces as '+', which @plus_is_space handles.
+static void percent_decode(Range range, bool plus_is_space, std::string& result) {
+    result.reserve(result.size() + (range.end - range.begin));
+    for (const char* position = range.begin; position < range.end; position++) {
+        if (*position == '%' && range.end - position > 2 && g_ascii_isxdigit(position[1]) && g_ascii_isxdigit(position[2])) {
+            result.push_back(static_cast<char>(g_ascii_xdigit_value(position[1]) << 4 | g_ascii_xdigit_value(position[2])));
+            position += 2;
+        } else {
+            result.push_back(plus_is_space && *position == '+' ? ' ' : *position);
+        }
+    }
+}
+
+// Reads the next parameter of @query, advancing its beginning.
+static bool next_query_parameter(Range& query, std::string& name, Range& value) {
+    while (query.begin < query.end) {
+        const char* parameter_end = find(query, "&");
+        Range parameter = {query.begin, parameter_end};
+        query.begin = parameter_end == query.end ? query.end : parameter_end + 1;
+        if (parameter.begin == parameter.end) {
+            continue;
+        }
+        const char* separator = find(parameter, "=");
+        name.clear();
+        percent_decode({parameter.begin, separator}, true, name);
+        value = {separator == parameter.end ? parameter.end : separator + 1, parameter.end};
+        return true;
+    }
+    return false;
+}
+
+// Splits "scheme://host/path?query#fragment" into its host, path and query.
+static void split_uri(Range uri, Range& host, Range& path, Range& query) {
+    const char* authority = strstr(uri.begin, "://") + 3;
+    const char* path_begin = find({authority, uri.end}, "/?#");
+    const char* query_begin = find({path_begin, uri.end}, "?#");
+    const char* fragment_begin = find({query_begin, uri.end}, "#");
+    host = {authority, path_begin};
+    path = {path_begin, query_begin};
+    query = {query_begin == fragment_begin ? fragment_begin : query_begin + 1, fragment_begin};
+}
+
+// Uppercases @secret and strips its spaces, dashes and padding.
+static bool normalize_secret(const std::string& secret, std::string& result) {
+    result.clear();
+    result.reserve(secret.size());
+    for (char c : secret) {
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '2' && c <= '7')) {
+            result.push_back(g_ascii_toupper(c));
+        } else if (c != ' ' && c != '-' && c != '=') {
+            return false;
+        }
+    }
+    // Other lengths would leave a partial byte.
+    size_t remainder = result.size() % 8;
+    if (remainder == 1 || remainder == 3 || remainder == 6) {
+        return false;
+    }
+    std::vector<uint8_t> key;
+    bool valid = totp_decode_base32(result, key);
+    vault_wipe(key);
+    return valid;
+}
+
+// Only accepts the values `Algorithm.fromString` knows, but regardless of
+// their case.
+static std::string normalize_algorithm(const std::string& algorithm) {
+    std::string result(algorithm);
+    for (char& c : result) {
+        c = g_ascii_tolower(c);
+    }
+    return result == "sha1" || result == "sha256" || result == "sha512" ? result : std::string();
+}
+
+// Returns 0 unless @text is a positive number, like `int.tryParse` would
+// return null.
+static int parse_positive_int(const std::string& text) {
+    guint64 value = 0;
+    if (text.empty() || !g_ascii_string_to_unsigned(text.c_str(), 10, 1, G_MAXINT, &value, nullptr)) {
+        return 0;
+    }
+    return static_cast<int>(value);
+}
+
+static bool parse_otpauth_uri(Range uri, ImportedTotp& totp) {
+    Range host, path, query;
+    split_uri(uri, host, path, query);
+    if (!equals(host, "totp")) {
+        return false;
+    }
+    std::string secret, name, value;
+    bool has_secret = false;
+    Range parameter;
+    while (next_query_parameter(query, name, parameter)) {
+        value.clear();
+        percent_decode(parameter, true, value);
+        if (name == "secret") {
+            secret.swap(value);
+            has_secret = true;
+        } else if (name == "issuer") {
+            totp.issuer = value;
+            totp.has_issuer = true;
+        } else if (name == "algorithm") {
+            totp.algorithm = normalize_algorithm(value);
+        } else if (name == "digits") {
+            totp.digits = parse_positive_int(value);
+        } else if (name == "period") {
+            totp.validity = parse_positive_int(value);
+        }
+    }
+    bool valid = has_secret && normalize_secret(secret, totp.secret);
+    vault_wipe(secret);
+    vault_wipe(value);
+    if (!valid) {
+        return false;
+    }
+    percent_decode(path, false, totp.label);
+    if (!totp.label.empty() && totp.label[0] == '/') {
+        totp.label.erase(0, 1);
+    }
+    return true;
+}
+
+static bool read_varint(const uint8_t*& position, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && position < end; shift += 7) {
+        uint8_t byte = *position++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool read_field(const uint8_t*& position, const uint8_t* end, ProtobufField& field) {
+    uint64_t key = 0;
+    if (!read_varint(position, end, key)) {
+        return false;
+    }
+    field.number = key >> 3;
+    field.wire_type = static_cast<int>(key & 7);
+    switch (field.wire_type) {
+        case 0:
+            return read_varint(position, end, field.varint);
+        case 1:
+        case 5: {
+            size_t size = field.wire_type == 1 ? 8 : 4;
+            if (static_cast<size_t>(end - position) < size) {
+                return false;
+            }
+            position += size;
+            return true;
+        }
+        case 2: {
+            uint64_t length = 0;
+            if (!read_varint(position, end, length) || length > static_cast<uint64_t>(end - position)) {
+                return false;
+            }
+            field.data = position;
+            field.length = length;
+            position += length;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Reads an `OtpParameters` message of a Google Authenticator export.
+static bool parse_otp_parameters(const uint8_t* position, const uint8_t* end, ImportedTotp& totp) {
+    const uint8_t* secret = nullptr;
+    size_t secret_length = 0;
+    uint64_t algorithm = 0;
+    uint64_t digits = 0;
+    uint64_t type = 0;
+    ProtobufField field;
+    while (position < end) {
+        if (!read_field(position, end, field)) {
+            return false;
+        }
+        if (field.wire_type == 2) {
+            if (field.number == 1) {
+                secret = field.data;
+                secret_length = field.length;
+            } else if (field.number == 2) {
+                totp.label.assign(reinterpret_cast<const char*>(field.data), field.length);
+            } else if (field.number == 3 && field.length > 0) {
+                totp.issuer.assign(reinterpret_cast<const char*>(field.data), field.length);
+                totp.has_issuer = true;
+            }
+        } else if (field.wire_type == 0) {
+            if (field.number == 4) {
+                algorithm = field.varint;
+            } else if (field.number == 5) {
+                digits = field.varint;
+            } else if (field.number == 6) {
+                type = field.varint;
+            }
+        }
+    }
+    if (secret_length == 0 || type == kMigrationTypeHotp) {
+        return false;
+    }
+    if (algorithm == kMigrationAlgorithmSha256) {
+        totp.algorithm = "sha256";
+    } else if (algorithm == kMigrationAlgorithmSha512) {
+        totp.algorithm = "sha512";
+    } else if (algorithm != 0 && algorithm != kMigrationAlgorithmSha1) {
+        return false;
+    }
+    if (digits == kMigrationDigitsEight) {
+        totp.digits = 8;
+    } else if (digits != 0 && digits != kMigrationDigitsSix) {
+        return false;
+    }
+    totp.secret = totp_encode_base32(secret, secret_length);
+    return true;
+}
+
+// Reads the `MigrationPayload` message of a Google Authenticator export.
+// Returns the number of accounts that couldn't be read.
+static int parse_migration_uri(Range uri, std::vector<ImportedTotp>& totps) {
+    Range host, path, query;
+    split_uri(uri, host, path, query);
+    if (!equals(host, "offline")) {
+        return 1;
+    }
+    std::string data, name;
+    Range parameter;
+    while (next_query_parameter(query, name, parameter)) {
+        if (name == "data") {
+            vault_wipe(data);
+            data.clear();
+            // Base64 has no spaces, so a '+' that hasn't been encoded is kept.
+            percent_decode(parameter, false, data);
+        }
+    }
+    for (char& c : data) {
+        c = c == '-' ? '+' : (c == '_' ? '/' : c);
+    }
+    gsize length = 0;
+    const uint8_t* position = data.empty() ? nullptr : g_base64_decode_inplace(&data[0], &length);
+    const uint8_t* end = position + length;
+    int rejected = 0;
+    ProtobufField field;
+    while (position < end) {
+        if (!read_field(position, end, field)) {
+            rejected++;
+            break;
+        }
+        if (field.number != 1 || field.wire_type != 2) {
+            continue;
+        }
+        ImportedTotp totp;
+        if (parse_otp_parameters(field.data, field.data + field.length, totp)) {
+            totps.push_back(std::move(totp));
+        } else {
+            vault_wipe(totp.secret);
+            rejected++;
+        }
+    }
+    vault_wipe(data);
+    return length == 0 ? 1 : rejected;
+}
+
+int totp_import_parse(const std::string& text, std::vector<ImportedTotp>& totps) {
+    int rejected = 0;
+    const char* position = text.data();
+    const char* end = position + text.size();
+    while (position < end) {
+        if (g_ascii_isspace(*position)) {
+            position++;
+            continue;
+        }
+        Range uri = {position, position};
+        while (uri.end < end && !g_ascii_isspace(*uri.end)) {
+            uri.end++;
+        }
+        position = uri.end;
+        if (starts_with(uri, "otpauth-migration://")) {
+            rejected += parse_migration_uri(uri, totps);
+        } else if (starts_with(uri, "otpauth://")) {
+            ImportedTotp totp;
+            if (parse_otpauth_uri(uri, totp)) {
+                totps.push_back(std::move(totp));
+            } else {
+                rejected++;
+            }
+        } else {
+            rejected++;
+        }
+    }
+    return rejected;
+}
+
+void totp_import_wipe(std::vector<ImportedTotp>& totps) {
+    for (ImportedTotp& totp : totps) {
+        vault_wipe(totp.secret);
+    }
+}
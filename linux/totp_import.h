@@ -0,0 +1,38 @@
+#ifndef FLUTTER_TOTP_IMPORT_H_
+#define FLUTTER_TOTP_IMPORT_H_
+
+#include <string>
+#include <vector>
+
+// A TOTP read from an otpauth:// or otpauth-migration:// URI.
+struct ImportedTotp {
+    // Uppercase, unpadded base32.
+    std::string secret;
+    std::string label;
+    std::string issuer;
+    bool has_issuer = false;
+    // Empty or zero when not specified.
+    std::string algorithm;
+    int digits = 0;
+    int validity = 0;
+};
+
+/**
+ * totp_import_parse:
+ * @text: otpauth:// and otpauth-migration:// URIs, separated by whitespace.
+ * @totps: where to append the TOTPs.
+ *
+ * Reads the TOTPs the same way `DecryptedTotp.fromUri` does, and those of
+ * Google Authenticator exports. Secrets are validated and normalized.
+ *
+ * Returns: the number of URIs, or migrated accounts, that couldn't be read.
+ */
+int totp_import_parse(const std::string& text, std::vector<ImportedTotp>& totps);
+
+/**
+ * totp_import_wipe:
+ * @totps: the TOTPs whose secrets should be overwritten.
+ */
+void totp_import_wipe(std::vector<ImportedTotp>& totps);
+
+#endif  // FLUTTER_TOTP_IMPORT_H_
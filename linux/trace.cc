@@ -0,0 +1,96 @@
+#include "trace.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// The number of spans kept per thread, the oldest ones being overwritten.
+static const size_t kSpansPerThread = 4096;
+
+struct Span {
+    const char* name;
+    gint64 start;
+    gint64 end;
+};
+
+// The spans of a thread. Only that thread writes to it, the lock being taken
+// by the exporter.
+struct ThreadBuffer {
+    std::mutex mutex;
+    pid_t thread_id;
+    std::vector<Span> spans;
+    size_t next = 0;
+};
+
+static std::atomic<bool> enabled(g_getenv("OPENAUTH_TRACE") != nullptr);
+
+// Every thread buffer, kept after their thread has exited so that their spans
+// can still be exported. Never destroyed, as threads may still record spans
+// during static destruction.
+static std::mutex& buffers_mutex = *new std::mutex();
+static std::vector<std::shared_ptr<ThreadBuffer>>& buffers = *new std::vector<std::shared_ptr<ThreadBuffer>>();
+
+static ThreadBuffer& get_thread_buffer() {
+    thread_local std::shared_ptr<ThreadBuffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<ThreadBuffer>();
+        buffer->thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+        buffer->spans.reserve(kSpansPerThread);
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void trace_set_enabled(bool value) {
+    enabled.store(value, std::memory_order_relaxed);
+}
+
+bool trace_is_enabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void trace_add_span(const char* name, gint64 start) {
+    if (!trace_is_enabled()) {
+        return;
+    }
+    Span span = {name, start, g_get_monotonic_time()};
+    ThreadBuffer& buffer = get_thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.spans.size() < kSpansPerThread) {
+        buffer.spans.push_back(span);
+    } else {
+        buffer.spans[buffer.next] = span;
+    }
+    buffer.next = (buffer.next + 1) % kSpansPerThread;
+}
+
+std::string trace_export_chrome_json(gint64 clock_offset) {
+    int pid = getpid();
+    GString* json = g_string_new("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    g_string_append_printf(json, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", pid, pid, g_get_prgname());
+    std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        for (const Span& span : buffer->spans) {
+            g_string_append_printf(json, ",{\"name\":\"%s\",\"cat\":\"native\",\"ph\":\"X\",\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%d}", span.name, span.start + clock_offset, span.end - span.start, pid, buffer->thread_id);
+        }
+    }
+    g_string_append(json, "]}");
+    std::string result(json->str, json->len);
+    g_string_free(json, TRUE);
+    return result;
+}
+
+void trace_clear() {
+    std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+    for (const std::shared_ptr<ThreadBuffer>& buffer : buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        buffer->spans.clear();
+        buffer->next = 0;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef FLUTTER_TRACE_H_
+#define FLUTTER_TRACE_H_
+
+#include <glib.h>
+
+#include <string>
+
+/**
+ * trace_set_enabled:
+ * @enabled: whether spans should be recorded.
+ *
+ * Enables or disables tracing. Tracing is enabled at startup if
+ * `OPENAUTH_TRACE` is set.
+ */
+void trace_set_enabled(bool enabled);
+
+/**
+ * trace_is_enabled:
+ *
+ * Returns: whether spans are being recorded.
+ */
+bool trace_is_enabled();
+
+/**
+ * trace_add_span:
+ * @name: the span name, which must be a static string.
+ * @start: when the span has started, as returned by g_get_monotonic_time().
+ *
+ * Records a span that ends now. Useful for spans that start and end in
+ * different callbacks, TraceSpan being simpler otherwise.
+ */
+void trace_add_span(const char* name, gint64 start);
+
+/**
+ * trace_export_chrome_json:
+ * @clock_offset: added to every timestamp, in microseconds.
+ *
+ * Returns: the recorded spans of every thread, using the Chrome trace event
+ * format. Timestamps come from the monotonic clock, which is the one the Dart
+ * `Timeline` uses, so that both traces can be opened together in Perfetto.
+ * @clock_offset allows to correct any difference.
+ */
+std::string trace_export_chrome_json(gint64 clock_offset);
+
+/**
+ * trace_clear:
+ *
+ * Drops every recorded span.
+ */
+void trace_clear();
+
+// Records a span covering its lifetime, in the buffer of the current thread.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) : name_(name), start_(trace_is_enabled() ? g_get_monotonic_time() : 0) {}
+    ~TraceSpan() {
+        if (start_ != 0) {
+            trace_add_span(name_, start_);
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    gint64 start_;
+};
+
+#endif  // FLUTTER_TRACE_H_
@@ -0,0 +1,210 @@
+#include "vault.h"
+
+#include <argon2.h>
+#include <glib.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "metrics.h"
+#include "trace.h"
+
+// Must match the Argon2Parameters generated by `bin/generate.dart`.
+static const uint32_t kArgon2Iterations = 3;
+static const uint32_t kArgon2Parallelism = 8;
+static const uint32_t kArgon2MemorySize = 1 << 18;
+
+static const size_t kKeyLength = 256 / 8;
+static const size_t kInitializationVectorLength = 96 / 8;
+static const size_t kAuthenticationTagLength = 128 / 8;
+
+// Counts the buffers holding secrets or their working state in the
+// memory.crypto_buffers_bytes gauge, while in scope.
+class ScopedCryptoBuffers {
+public:
+    explicit ScopedCryptoBuffers(size_t size) : size_(static_cast<int64_t>(size)) {
+        GetGauge().Add(size_);
+    }
+    ~ScopedCryptoBuffers() {
+        GetGauge().Add(-size_);
+    }
+
+    ScopedCryptoBuffers(const ScopedCryptoBuffers&) = delete;
+    ScopedCryptoBuffers& operator=(const ScopedCryptoBuffers&) = delete;
+
+private:
+    static metrics::Gauge& GetGauge() {
+        static metrics::Gauge& gauge = metrics::Registry::Get().GetGauge("memory.crypto_buffers_bytes");
+        return gauge;
+    }
+
+    int64_t size_;
+};
+
+char* vault_get_default_path() {
+    // Where path_provider puts the application support directory, and drift
+    // the database.
+    return g_build_filename(g_get_user_data_dir(), APPLICATION_ID, "totps.sqlite", nullptr);
+}
+
+// Decodes a base64 text column, which is how drift stores binary data.
+static std::vector<uint8_t> read_base64_column(sqlite3_stmt* statement, int column) {
+    const unsigned char* text = sqlite3_column_text(statement, column);
+    if (text == nullptr) {
+        return std::vector<uint8_t>();
+    }
+    gsize length = 0;
+    guchar* data = g_base64_decode(reinterpret_cast<const gchar*>(text), &length);
+    std::vector<uint8_t> result(data, data + length);
+    g_free(data);
+    return result;
+}
+
+bool vault_read_entries(const char* path, const char* uuid, std::vector<VaultEntry>& entries, std::string& error) {
+    static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("vault.read_us");
+    metrics::ScopedTimer timer(latency);
+    TraceSpan span("vault.read");
+    sqlite3* database = nullptr;
+    if (sqlite3_open_v2(path, &database, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK) {
+        error = database == nullptr ? "Cannot open the database." : sqlite3_errmsg(database);
+        sqlite3_close(database);
+        return false;
+    }
+    std::unique_ptr<sqlite3, decltype(&sqlite3_close)> database_closer(database, sqlite3_close);
+
+    std::string query = "SELECT uuid, secret, label, issuer, algorithm, digits, validity, encryption_salt FROM totps";
+    if (uuid != nullptr) {
+        query += " WHERE uuid = ?1";
+    }
+    sqlite3_stmt* statement = nullptr;
+    if (sqlite3_prepare_v2(database, query.c_str(), -1, &statement, nullptr) != SQLITE_OK) {
+        error = sqlite3_errmsg(database);
+        return false;
+    }
+    std::unique_ptr<sqlite3_stmt, decltype(&sqlite3_finalize)> statement_finalizer(statement, sqlite3_finalize);
+    if (uuid != nullptr) {
+        sqlite3_bind_text(statement, 1, uuid, -1, SQLITE_STATIC);
+    }
+
+    int status;
+    while ((status = sqlite3_step(statement)) == SQLITE_ROW) {
+        VaultEntry entry;
+        entry.uuid = reinterpret_cast<const char*>(sqlite3_column_text(statement, 0));
+        entry.encrypted_secret = read_base64_column(statement, 1);
+        entry.encrypted_label = read_base64_column(statement, 2);
+        entry.encrypted_issuer = read_base64_column(statement, 3);
+        const unsigned char* algorithm = sqlite3_column_text(statement, 4);
+        entry.algorithm = algorithm == nullptr ? "" : reinterpret_cast<const char*>(algorithm);
+        entry.digits = sqlite3_column_type(statement, 5) == SQLITE_NULL ? 0 : sqlite3_column_int(statement, 5);
+        entry.validity = sqlite3_column_type(statement, 6) == SQLITE_NULL ? 0 : sqlite3_column_int(statement, 6);
+        entry.encryption_salt = read_base64_column(statement, 7);
+        entries.push_back(std::move(entry));
+    }
+    if (status != SQLITE_DONE) {
+        error = sqlite3_errmsg(database);
+        return false;
+    }
+    return true;
+}
+
+bool vault_derive_key(const std::string& password, const std::vector<uint8_t>& salt, std::vector<uint8_t>& key) {
+    static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("vault.derive_key_us");
+    metrics::ScopedTimer timer(latency);
+    TraceSpan span("vault.deriveKey");
+    // Argon2 allocates kArgon2MemorySize KiB.
+    ScopedCryptoBuffers buffers(static_cast<size_t>(kArgon2MemorySize) * 1024);
+    key.resize(kKeyLength);
+    return argon2id_hash_raw(kArgon2Iterations, kArgon2MemorySize, kArgon2Parallelism, password.data(), password.size(), salt.data(), salt.size(), key.data(), key.size()) == ARGON2_OK;
+}
+
+bool vault_decrypt(const std::vector<uint8_t>& key, const std::vector<uint8_t>& data, std::string& result) {
+    static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("vault.decrypt_us");
+    metrics::ScopedTimer timer(latency);
+    TraceSpan span("vault.decrypt");
+    if (key.size() != kKeyLength || data.size() < kInitializationVectorLength + kAuthenticationTagLength) {
+        return false;
+    }
+    const uint8_t* initialization_vector = data.data();
+    const uint8_t* encrypted = initialization_vector + kInitializationVectorLength;
+    int encrypted_length = static_cast<int>(data.size() - kInitializationVectorLength - kAuthenticationTagLength);
+    const uint8_t* tag = encrypted + encrypted_length;
+
+    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
+    std::vector<uint8_t> decrypted(encrypted_length + kAuthenticationTagLength);
+    ScopedCryptoBuffers buffers(decrypted.size());
+    int length = 0;
+    int final_length = 0;
+    bool success = context != nullptr &&
+        EVP_DecryptInit_ex(context.get(), EVP_aes_256_gcm(), nullptr, key.data(), initialization_vector) == 1 &&
+        EVP_DecryptUpdate(context.get(), decrypted.data(), &length, encrypted, encrypted_length) == 1 &&
+        EVP_CIPHER_CTX_ctrl(context.get(), EVP_CTRL_GCM_SET_TAG, kAuthenticationTagLength, const_cast<uint8_t*>(tag)) == 1 &&
+        EVP_DecryptFinal_ex(context.get(), decrypted.data() + length, &final_length) == 1;
+    if (success) {
+        result.assign(reinterpret_cast<const char*>(decrypted.data()), length + final_length);
+    }
+    vault_wipe(decrypted);
+    return success;
+}
+
+bool vault_encrypt(const std::vector<uint8_t>& key, const std::vector<const std::string*>& texts, std::vector<std::vector<uint8_t>>& results) {
+    static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("vault.encrypt_batch_us");
+    metrics::ScopedTimer timer(latency);
+    TraceSpan span("vault.encrypt");
+    results.clear();
+    if (key.size() != kKeyLength) {
+        return false;
+    }
+    // The initialization vectors and the encrypted texts, counted until the
+    // latter are handed to the caller.
+    size_t buffers_size = 0;
+    for (const std::string* text : texts) {
+        buffers_size += 2 * kInitializationVectorLength + text->size() + kAuthenticationTagLength;
+    }
+    ScopedCryptoBuffers buffers(buffers_size);
+    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> context(EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_free);
+    std::vector<uint8_t> initialization_vectors(texts.size() * kInitializationVectorLength);
+    if (context == nullptr ||
+        EVP_EncryptInit_ex(context.get(), EVP_aes_256_gcm(), nullptr, key.data(), nullptr) != 1 ||
+        (!texts.empty() && RAND_bytes(initialization_vectors.data(), static_cast<int>(initialization_vectors.size())) != 1)) {
+        return false;
+    }
+    results.resize(texts.size());
+    for (size_t i = 0; i < texts.size(); i++) {
+        const std::string& text = *texts[i];
+        std::vector<uint8_t>& result = results[i];
+        const uint8_t* initialization_vector = initialization_vectors.data() + i * kInitializationVectorLength;
+        result.resize(kInitializationVectorLength + text.size() + kAuthenticationTagLength);
+        std::copy(initialization_vector, initialization_vector + kInitializationVectorLength, result.begin());
+        uint8_t* encrypted = result.data() + kInitializationVectorLength;
+        int length = 0;
+        int final_length = 0;
+        // Only sets the initialization vector, keeping the expanded key.
+        bool success = EVP_EncryptInit_ex(context.get(), nullptr, nullptr, nullptr, initialization_vector) == 1 &&
+            EVP_EncryptUpdate(context.get(), encrypted, &length, reinterpret_cast<const uint8_t*>(text.data()), static_cast<int>(text.size())) == 1 &&
+            EVP_EncryptFinal_ex(context.get(), encrypted + length, &final_length) == 1 &&
+            EVP_CIPHER_CTX_ctrl(context.get(), EVP_CTRL_GCM_GET_TAG, kAuthenticationTagLength, encrypted + length + final_length) == 1;
+        if (!success) {
+            results.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void vault_wipe(std::string& data) {
+    if (!data.empty()) {
+        OPENSSL_cleanse(&data[0], data.size());
+    }
+    data.clear();
+}
+
+void vault_wipe(std::vector<uint8_t>& data) {
+    if (!data.empty()) {
+        OPENSSL_cleanse(data.data(), data.size());
+    }
+    data.clear();
+}
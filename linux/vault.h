@@ -0,0 +1,86 @@
+#ifndef FLUTTER_VAULT_H_
+#define FLUTTER_VAULT_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// A TOTP, as stored by the app local storage. See `lib/model/storage/local.dart`.
+struct VaultEntry {
+    std::string uuid;
+    std::vector<uint8_t> encrypted_secret;
+    std::vector<uint8_t> encrypted_label;
+    std::vector<uint8_t> encrypted_issuer;
+    // The salt of the key that has encrypted the data.
+    std::vector<uint8_t> encryption_salt;
+    std::string algorithm;
+    int digits;
+    int validity;
+};
+
+/**
+ * vault_get_default_path:
+ *
+ * Returns: the path of the database the app stores its TOTPs in. Free with
+ * g_free().
+ */
+char* vault_get_default_path();
+
+/**
+ * vault_read_entries:
+ * @path: the database path.
+ * @uuid: (nullable): the UUID of the entry to read, or nullptr to read them all.
+ * @entries: where to append the entries.
+ * @error: the error message, if any.
+ *
+ * Returns: whether the database has been read.
+ */
+bool vault_read_entries(const char* path, const char* uuid, std::vector<VaultEntry>& entries, std::string& error);
+
+/**
+ * vault_derive_key:
+ * @password: the master password.
+ * @salt: the salt the key has been derived with.
+ * @key: where to write the key.
+ *
+ * Derives a key the same way `CryptoStore` does.
+ *
+ * Returns: whether the key has been derived.
+ */
+bool vault_derive_key(const std::string& password, const std::vector<uint8_t>& salt, std::vector<uint8_t>& key);
+
+/**
+ * vault_decrypt:
+ * @key: the key.
+ * @data: the initialization vector, followed by the encrypted data and its
+ *   authentication tag.
+ * @result: where to write the decrypted data.
+ *
+ * Returns: whether @data has been decrypted, which fails if @key is wrong.
+ */
+bool vault_decrypt(const std::vector<uint8_t>& key, const std::vector<uint8_t>& data, std::string& result);
+
+/**
+ * vault_encrypt:
+ * @key: the key.
+ * @texts: the texts to encrypt.
+ * @results: where to write the encrypted texts, in the same order. Each one
+ *   is a random initialization vector, followed by the encrypted text and its
+ *   authentication tag, like `CryptoStore.encrypt` does.
+ *
+ * Encrypts a whole batch with a single cipher context, so that the key is
+ * only expanded once.
+ *
+ * Returns: whether every text has been encrypted.
+ */
+bool vault_encrypt(const std::vector<uint8_t>& key, const std::vector<const std::string*>& texts, std::vector<std::vector<uint8_t>>& results);
+
+/**
+ * vault_wipe:
+ * @data: the sensitive data to overwrite.
+ */
+void vault_wipe(std::string& data);
+void vault_wipe(std::vector<uint8_t>& data);
+
+#endif  // FLUTTER_VAULT_H_
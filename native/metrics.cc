@@ -0,0 +1,217 @@
+#include "metrics.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace metrics {
+
+namespace {
+
+// Returns the index of the most significant bit set in a non-zero value.
+int MostSignificantBit(uint64_t value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanReverse64(&index, value);
+  return static_cast<int>(index);
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+void AppendJsonString(std::string& json, const std::string& value) {
+  json += '"';
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      json += '\\';
+    }
+    json += c;
+  }
+  json += '"';
+}
+
+void AppendNumber(std::string& json, uint64_t value) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), "%" PRIu64, value);
+  json += buffer;
+}
+
+void AppendNumber(std::string& json, int64_t value) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), "%" PRId64, value);
+  json += buffer;
+}
+
+template <typename T>
+T& GetOrCreate(std::map<std::string, std::unique_ptr<T>>& metrics, const std::string& name) {
+  std::unique_ptr<T>& metric = metrics[name];
+  if (!metric) {
+    metric.reset(new T());
+  }
+  return *metric;
+}
+
+}  // namespace
+
+size_t CurrentShard() {
+  static std::atomic<size_t> next_shard{0};
+  thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+  return shard;
+}
+
+int64_t Counter::Value() const {
+  int64_t value = 0;
+  for (const Shard& shard : shards_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+Histogram::Histogram() : shards_(new Shard[kShardCount]) {
+  for (size_t i = 0; i < kShardCount; i++) {
+    for (std::atomic<uint64_t>& bucket : shards_[i].buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void Histogram::Record(uint64_t value) {
+  Shard& shard = shards_[CurrentShard()];
+  shard.buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  shard.sum.fetch_add(value, std::memory_order_relaxed);
+  shard.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::GetSnapshot() const {
+  Snapshot snapshot;
+  snapshot.buckets.assign(kBucketCount, 0);
+  for (size_t i = 0; i < kShardCount; i++) {
+    const Shard& shard = shards_[i];
+    snapshot.count += shard.count.load(std::memory_order_relaxed);
+    snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    for (int bucket = 0; bucket < kBucketCount; bucket++) {
+      snapshot.buckets[bucket] += shard.buckets[bucket].load(std::memory_order_relaxed);
+    }
+  }
+  return snapshot;
+}
+
+int Histogram::BucketIndex(uint64_t value) {
+  if (value < static_cast<uint64_t>(kSubBucketCount)) {
+    return static_cast<int>(value);
+  }
+  int shift = MostSignificantBit(value) - kSubBucketBits;
+  int sub_bucket = static_cast<int>((value >> shift) & (kSubBucketCount - 1));
+  return (shift + 1) * kSubBucketCount + sub_bucket;
+}
+
+uint64_t Histogram::BucketLowerBound(int index) {
+  if (index < kSubBucketCount) {
+    return index;
+  }
+  int shift = index / kSubBucketCount - 1;
+  return static_cast<uint64_t>(kSubBucketCount + index % kSubBucketCount) << shift;
+}
+
+uint64_t Histogram::Snapshot::Percentile(double percentile) const {
+  // Buckets are summed without synchronization with count, so don't rely on
+  // them adding up to it.
+  uint64_t total = 0;
+  for (uint64_t bucket : buckets) {
+    total += bucket;
+  }
+  if (total == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(percentile / 100 * (total - 1));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    seen += buckets[i];
+    if (seen > rank) {
+      return BucketLowerBound(static_cast<int>(i));
+    }
+  }
+  return BucketLowerBound(kBucketCount - 1);
+}
+
+Registry& Registry::Get() {
+  static Registry* registry = new Registry();
+  return *registry;
+}
+
+Counter& Registry::GetCounter(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return GetOrCreate(counters_, name);
+}
+
+Gauge& Registry::GetGauge(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return GetOrCreate(gauges_, name);
+}
+
+Histogram& Registry::GetHistogram(const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return GetOrCreate(histograms_, name);
+}
+
+std::string Registry::SnapshotJson() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string json = "{\"counters\":{";
+  const char* separator = "";
+  for (const auto& counter : counters_) {
+    json += separator;
+    AppendJsonString(json, counter.first);
+    json += ':';
+    AppendNumber(json, counter.second->Value());
+    separator = ",";
+  }
+  json += "},\"gauges\":{";
+  separator = "";
+  for (const auto& gauge : gauges_) {
+    json += separator;
+    AppendJsonString(json, gauge.first);
+    json += ':';
+    AppendNumber(json, gauge.second->Value());
+    separator = ",";
+  }
+  json += "},\"histograms\":{";
+  separator = "";
+  for (const auto& histogram : histograms_) {
+    Histogram::Snapshot snapshot = histogram.second->GetSnapshot();
+    json += separator;
+    AppendJsonString(json, histogram.first);
+    json += ":{\"count\":";
+    AppendNumber(json, snapshot.count);
+    json += ",\"sum\":";
+    AppendNumber(json, snapshot.sum);
+    json += ",\"p50\":";
+    AppendNumber(json, snapshot.Percentile(50));
+    json += ",\"p90\":";
+    AppendNumber(json, snapshot.Percentile(90));
+    json += ",\"p99\":";
+    AppendNumber(json, snapshot.Percentile(99));
+    json += ",\"buckets\":[";
+    const char* bucket_separator = "";
+    for (int i = 0; i < Histogram::kBucketCount; i++) {
+      if (snapshot.buckets[i] == 0) {
+        continue;
+      }
+      json += bucket_separator;
+      json += '[';
+      AppendNumber(json, Histogram::BucketLowerBound(i));
+      json += ',';
+      AppendNumber(json, snapshot.buckets[i]);
+      json += ']';
+      bucket_separator = ",";
+    }
+    json += "]}";
+    separator = ",";
+  }
+  json += "}}";
+  return json;
+}
+
+}  // namespace metrics
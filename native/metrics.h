@@ -0,0 +1,144 @@
+#ifndef NATIVE_METRICS_H_
+#define NATIVE_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Metrics shared by the Windows and Linux runners.
+//
+// Metrics are registered by name in the Registry, which takes a lock. Once
+// registered, recording a value is lock-free, so callers should keep the
+// returned reference, typically in a function-local static:
+//
+//   static metrics::Histogram& latency =
+//       metrics::Registry::Get().GetHistogram("polkit.authenticate_us");
+//   metrics::ScopedTimer timer(latency);
+namespace metrics {
+
+// The number of shards counters and histograms are split into. Each thread
+// writes to its own shard, and shards get merged on read, so that concurrent
+// writers don't contend on the same cache line.
+constexpr size_t kShardCount = 8;
+
+// Returns the shard of the current thread.
+size_t CurrentShard();
+
+// A monotonically increasing count.
+class Counter {
+ public:
+  void Increment(int64_t delta = 1) {
+    shards_[CurrentShard()].value.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  int64_t Value() const;
+
+ private:
+  // Padded to a cache line.
+  struct Shard {
+    std::atomic<int64_t> value{0};
+    char padding[64 - sizeof(std::atomic<int64_t>)];
+  };
+
+  Shard shards_[kShardCount];
+};
+
+// A value that can go up and down.
+class Gauge {
+ public:
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void Add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+  int64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+// A distribution of non-negative values. Buckets are log-linear : every power
+// of two is split into kSubBucketCount buckets, which bounds the relative
+// error of the reported values to 1 / kSubBucketCount.
+class Histogram {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kSubBucketCount = 1 << kSubBucketBits;
+  static constexpr int kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketCount;
+
+  struct Snapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    std::vector<uint64_t> buckets;
+
+    // Returns the lower bound of the bucket containing the given percentile
+    // (between 0 and 100), or 0 if nothing has been recorded.
+    uint64_t Percentile(double percentile) const;
+  };
+
+  Histogram();
+
+  void Record(uint64_t value);
+  Snapshot GetSnapshot() const;
+
+  static int BucketIndex(uint64_t value);
+  static uint64_t BucketLowerBound(int index);
+
+ private:
+  struct Shard {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> buckets[kBucketCount];
+  };
+
+  std::unique_ptr<Shard[]> shards_;
+};
+
+// Records the time elapsed during its lifetime in a histogram, in
+// microseconds.
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(Histogram& histogram)
+      : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    histogram_.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_).count()));
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  Histogram& histogram_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// All the metrics of the process, by name.
+class Registry {
+ public:
+  // Never destroyed, as metrics may be recorded during static destruction.
+  static Registry& Get();
+
+  Counter& GetCounter(const std::string& name);
+  Gauge& GetGauge(const std::string& name);
+  Histogram& GetHistogram(const std::string& name);
+
+  // Returns every metric, as a JSON object with "counters", "gauges" and
+  // "histograms" entries. Histograms only list their non-empty buckets, as
+  // [lower bound, count] pairs.
+  std::string SnapshotJson() const;
+
+ private:
+  Registry() = default;
+
+  mutable std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<Counter>> counters_;
+  std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+  std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+};
+
+}  // namespace metrics
+
+#endif  // NATIVE_METRICS_H_
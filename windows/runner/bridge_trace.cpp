@@ -0,0 +1,96 @@
+#include "bridge_trace.h"
+
+#include <cstring>
+
+namespace {
+
+int64_t ToNanoseconds(std::chrono::steady_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+uint32_t CurrentThreadId() {
+  static std::atomic<uint32_t> next_thread_id{1};
+  thread_local uint32_t thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+  return thread_id;
+}
+
+}  // namespace
+
+BridgeTrace& BridgeTrace::Get() {
+  static BridgeTrace trace;
+  return trace;
+}
+
+void BridgeTrace::Record(const char* name, std::chrono::steady_clock::time_point start, int error) {
+  if (!IsEnabled()) {
+    return;
+  }
+  Event event;
+  event.name = name;
+  event.start_ns = ToNanoseconds(start);
+  event.end_ns = ToNanoseconds(std::chrono::steady_clock::now());
+  event.error = error;
+  event.thread_id = CurrentThreadId();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (events_.size() < kCapacity) {
+    events_.push_back(event);
+  } else {
+    events_[next_] = event;
+    next_ = (next_ + 1) % kCapacity;
+  }
+}
+
+BridgeTrace::LatencyHistogram BridgeTrace::GetLatencyHistogram(const char* name) {
+  LatencyHistogram histogram;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const Event& event : events_) {
+    if (std::strcmp(event.name, name) != 0) {
+      continue;
+    }
+    uint64_t latency_ns = event.end_ns > event.start_ns ? static_cast<uint64_t>(event.end_ns - event.start_ns) : 0;
+    histogram.count++;
+    histogram.total_ns += latency_ns;
+    if (latency_ns > histogram.max_ns) {
+      histogram.max_ns = latency_ns;
+    }
+    int bucket = 0;
+    for (uint64_t latency_us = latency_ns / 1000; latency_us > 0 && bucket < kHistogramBucketCount - 1; latency_us >>= 1) {
+      bucket++;
+    }
+    histogram.buckets[bucket]++;
+  }
+  return histogram;
+}
+
+std::string BridgeTrace::ExportChromeTrace() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string json = "{\"traceEvents\":[";
+  for (size_t index = 0; index < events_.size(); index++) {
+    // Oldest first.
+    const Event& event = events_[(next_ + index) % events_.size()];
+    if (index > 0) {
+      json += ',';
+    }
+    // Names are static identifiers, which need no escaping.
+    json += "{\"name\":\"";
+    json += event.name;
+    json += "\",\"cat\":\"bridge\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+    json += std::to_string(event.thread_id);
+    json += ",\"ts\":";
+    json += std::to_string(event.start_ns / 1000);
+    json += ",\"dur\":";
+    json += std::to_string((event.end_ns - event.start_ns) / 1000);
+    json += ",\"args\":{\"error\":";
+    json += std::to_string(event.error);
+    json += "}}";
+  }
+  json += "]}";
+  return json;
+}
+
+void BridgeTrace::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.clear();
+  next_ = 0;
+}
@@ -0,0 +1,86 @@
+#ifndef RUNNER_BRIDGE_TRACE_H_
+#define RUNNER_BRIDGE_TRACE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records the round trips of the runner's Firebase bridge (eg. an ID token
+// requested from Dart, or a future returned to the SDK) while enabled at
+// runtime, to find out why some of them stall. It doesn't depend on Flutter
+// nor Firebase, so that it can be used by any runner.
+//
+// Only the most recent kCapacity calls are kept.
+class BridgeTrace {
+ public:
+  // Number of calls kept.
+  static constexpr size_t kCapacity = 4096;
+  // Number of buckets of a LatencyHistogram.
+  static constexpr int kHistogramBucketCount = 32;
+
+  // A completed call.
+  struct Event {
+    // Static string naming the call, eg. "user.getIdToken".
+    const char* name = nullptr;
+    // Times the call started and completed, in nanoseconds on the steady
+    // clock.
+    int64_t start_ns = 0;
+    int64_t end_ns = 0;
+    // Error the call completed with.
+    int error = 0;
+    // Identifier of the completing thread, assigned by the trace.
+    uint32_t thread_id = 0;
+  };
+
+  // Latencies of the recorded calls of a given name.
+  struct LatencyHistogram {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    // Bucket 0 counts latencies under 1us, and bucket i > 0 the ones in
+    // [2^(i-1), 2^i) us. The last bucket also counts anything above.
+    uint64_t buckets[kHistogramBucketCount] = {};
+  };
+
+  // Returns the trace shared by the runner.
+  static BridgeTrace& Get();
+
+  BridgeTrace() = default;
+  BridgeTrace(BridgeTrace const&) = delete;
+  void operator=(BridgeTrace const&) = delete;
+
+  void SetEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  bool IsEnabled() const {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Records a call named |name| which started at |start| and completes now,
+  // unless disabled.
+  void Record(const char* name, std::chrono::steady_clock::time_point start, int error);
+
+  // Aggregates the latencies of the recorded calls named |name|.
+  LatencyHistogram GetLatencyHistogram(const char* name);
+
+  // Exports the recorded calls in the Chrome trace event format, which can
+  // be loaded in chrome://tracing or https://ui.perfetto.dev.
+  std::string ExportChromeTrace();
+
+  // Discards the recorded calls.
+  void Clear();
+
+ private:
+  std::atomic<bool> enabled_{false};
+
+  std::mutex mutex_;
+  // Ring buffer, whose oldest event is at |next_| once full.
+  std::vector<Event> events_;
+  size_t next_ = 0;
+};
+
+#endif  // RUNNER_BRIDGE_TRACE_H_
@@ -0,0 +1,53 @@
+#include "callback_executor.h"
+
+#include <utility>
+
+CallbackExecutor::CallbackExecutor(int thread_count) {
+  for (int index = 0; index < thread_count; index++) {
+    threads_.emplace_back(&CallbackExecutor::Run, this);
+  }
+}
+
+CallbackExecutor::~CallbackExecutor() {
+  Shutdown();
+}
+
+void CallbackExecutor::Post(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stopping_ && !threads_.empty()) {
+      tasks_.push_back(std::move(task));
+      tasks_changed_.notify_one();
+      return;
+    }
+  }
+  task();
+}
+
+void CallbackExecutor::Shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  tasks_changed_.notify_all();
+  for (std::thread& thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+void CallbackExecutor::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    tasks_changed_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+    if (tasks_.empty()) {
+      return;
+    }
+    Task task = std::move(tasks_.front());
+    tasks_.pop_front();
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef RUNNER_CALLBACK_EXECUTOR_H_
+#define RUNNER_CALLBACK_EXECUTOR_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs callbacks away from the thread posting them, eg. so that completing a
+// future or notifying listeners from a method call handler doesn't run their
+// callbacks on the platform thread. It doesn't depend on Flutter nor
+// Firebase, so that it can be used by any runner.
+//
+// Tasks run in the order they were posted when there's a single thread.
+// Without any thread, they run inline, which remains the cheapest option for
+// trivial callbacks.
+class CallbackExecutor {
+ public:
+  using Task = std::function<void()>;
+
+  explicit CallbackExecutor(int thread_count = 1);
+  // Runs the remaining tasks, then stops the threads.
+  ~CallbackExecutor();
+  CallbackExecutor(CallbackExecutor const&) = delete;
+  void operator=(CallbackExecutor const&) = delete;
+
+  // Runs |task| later, on one of the threads. Tasks posted once shut down
+  // run inline.
+  void Post(Task task);
+
+  // Runs the remaining tasks, then stops the threads. Can't be called from a
+  // task.
+  void Shutdown();
+
+ private:
+  // Runs tasks until shut down and no tasks are left.
+  void Run();
+
+  std::mutex mutex_;
+  std::condition_variable tasks_changed_;
+  std::deque<Task> tasks_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+#endif  // RUNNER_CALLBACK_EXECUTOR_H_
@@ -6,17 +6,51 @@
 #include <flutter/standard_method_codec.h>
 #include <windows.h>
 
+#include <algorithm>
+#include <chrono>
 #include <optional>
 
+#include "bridge_trace.h"
 #include "flutter/generated_plugin_registrant.h"
 #include "firebase/app_check.h"
 #include "firebase/app_check/debug_provider.h"
 #include "include/firebase/app/function_registry.h"
 #include "include/firebase/app/reference_counted_future_impl.h"
+#include "jwt.h"
+#include "metrics.h"
+
+PlatformAppCheckProvider::PlatformAppCheckProvider()
+  : token_cache_(RequestToken, kAppCheckTokenRefreshMargin) {}
 
 void PlatformAppCheckProvider::GetToken(std::function<void(firebase::app_check::AppCheckToken, int, const std::string&)> completion_callback) {
+  static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("app_check.get_token_us");
+  auto start = std::chrono::steady_clock::now();
+  token_cache_.Get([completion_callback, start](const TokenCache::Result& result) {
+    latency.Record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    if (result.error != 0) {
+      completion_callback({}, result.error, result.error_message);
+      return;
+    }
+    auto expire_time = std::chrono::system_clock::now().time_since_epoch() + result.time_to_live;
+    completion_callback(
+      firebase::app_check::AppCheckToken{
+        result.token,
+        std::chrono::duration_cast<std::chrono::milliseconds>(expire_time).count()
+      },
+      0,
+      ""
+    );
+  });
+}
+
+void PlatformAppCheckProvider::RequestToken(bool force_refresh, TokenCache::Callback callback) {
+  static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("app_check.request_token_us");
+  static metrics::Counter& errors = metrics::Registry::Get().GetCounter("app_check.request_token.errors");
   if (!FlutterWindow::instance || !FlutterWindow::instance->method_channel_app_check) {
-    completion_callback({}, -2, "Instance cannot be found.");
+    TokenCache::Result result;
+    result.error = -2;
+    result.error_message = "Instance cannot be found.";
+    callback(result);
     return;
   }
 
@@ -24,23 +58,39 @@ void PlatformAppCheckProvider::GetToken(std::function<void(firebase::app_check::
   auto arguments = std::make_unique<flutter::EncodableValue>(flutter::EncodableMap{
     {flutter::EncodableValue("publisher"), flutter::EncodableValue(publisher)},
   });
+
+  // Times the round trip to Dart.
+  auto start = std::chrono::steady_clock::now();
+  auto record = [start](int error) {
+    latency.Record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    if (error != 0) {
+      errors.Increment();
+    }
+    BridgeTrace::Get().Record("appCheck.requestToken", start, error);
+  };
   auto result_handler = std::make_unique<flutter::MethodResultFunctions<>>(
-    [completion_callback](const flutter::EncodableValue* value) {
+    [callback, record](const flutter::EncodableValue* value) {
+      record(0);
       auto token = std::get<flutter::EncodableMap>(*value);
-      completion_callback(
-        firebase::app_check::AppCheckToken{
-          std::get<std::string>(token["token"]),
-          std::get<std::int32_t>(token["ttl"])
-        },
-        0,
-        ""
-      );
+      TokenCache::Result result;
+      result.token = std::get<std::string>(token["token"]);
+      // The TTL is given in milliseconds.
+      result.time_to_live = std::chrono::milliseconds(std::get<std::int32_t>(token["ttl"]));
+      callback(result);
     },
-    [completion_callback](const std::string& error_code, const std::string& error_message, const void* error_details) {
-      completion_callback({}, -1, error_message);
+    [callback, record](const std::string& error_code, const std::string& error_message, const void* error_details) {
+      TokenCache::Result result;
+      result.error = -1;
+      record(result.error);
+      result.error_message = error_message;
+      callback(result);
     },
-    [completion_callback]() {
-      completion_callback({}, -3, "Method not implemented.");
+    [callback, record]() {
+      TokenCache::Result result;
+      result.error = -3;
+      record(result.error);
+      result.error_message = "Method not implemented.";
+      callback(result);
     }
   );
 
@@ -90,11 +140,17 @@ FlutterWindow* FlutterWindow::GetInstance(const flutter::DartProject& project) {
 }
 
 FlutterWindow::FlutterWindow(const flutter::DartProject& project)
-  : project_(project) {
+  : auth_state_listeners_([this](std::function<void()> notification) {
+      // Listeners run on the callback executor, like future completions.
+      callback_executor_.Post(std::move(notification));
+    }),
+    project_(project),
+    id_token_cache_(RequestIdToken, kIdTokenRefreshMargin) {
   future_manager().AllocFutureApi(this, kFlutterWindowFnCount);
 }
 
 FlutterWindow::~FlutterWindow() {
+  callback_executor_.Shutdown();
   future_manager().ReleaseFutureApi(this);
 }
 
@@ -121,26 +177,43 @@ bool FlutterWindow::OnCreate() {
     if (call.method_name() == "auth.install" || call.method_name() == "auth.userChanged") {
       const auto* arguments = std::get_if<flutter::EncodableMap>(call.arguments());
       auto userIdValue = arguments->find(flutter::EncodableValue("userUid"));
-      if (userIdValue != arguments->end()) {
-        user_uid = std::get<std::string>(userIdValue->second);
-      } else {
-        user_uid = std::optional<std::string>();
+      {
+        std::lock_guard<std::mutex> lock(user_uid_mutex_);
+        if (userIdValue != arguments->end()) {
+          user_uid = std::get<std::string>(userIdValue->second);
+        } else {
+          user_uid = std::optional<std::string>();
+        }
       }
+      id_token_cache_.Invalidate();
       if (call.method_name() == "auth.install") {
         const std::string appName = std::get<std::string>(arguments->find(flutter::EncodableValue("appName"))->second);
         firebase::App* app = firebase::App::GetInstance(appName.c_str());
         firebase::internal::FunctionRegistry* function_registry = app->function_registry();
-        function_registry->RegisterFunction(::firebase::internal::FnAuthAddAuthStateListener, AddListener);
-        function_registry->RegisterFunction(::firebase::internal::FnAuthRemoveAuthStateListener, RemoveListener);
-        function_registry->RegisterFunction(::firebase::internal::FnAuthGetTokenAsync, GetCurrentUserIdToken);
-        function_registry->RegisterFunction(::firebase::internal::FnAuthGetCurrentUserUid, GetCurrentUserUid);
+        function_registry->RegisterFunction(::firebase::internal::FnAuthAddAuthStateListener, CallCounted<AddListener>);
+        function_registry->RegisterFunction(::firebase::internal::FnAuthRemoveAuthStateListener, CallCounted<RemoveListener>);
+        function_registry->RegisterFunction(::firebase::internal::FnAuthGetTokenAsync, CallCounted<GetCurrentUserIdToken>);
+        function_registry->RegisterFunction(::firebase::internal::FnAuthGetCurrentUserUid, CallCounted<GetCurrentUserUid>);
         result->Success(true);
       } else {
-        for (const Entry& entry : callbacks) {
-          entry.first(entry.second);
-        }
+        auth_state_listeners_.Notify();
         result->Success(true);
       }
+    } else if (call.method_name() == "metrics.snapshot") {
+      result->Success(flutter::EncodableValue(metrics::Registry::Get().SnapshotJson()));
+    } else if (call.method_name() == "runner.functionStats") {
+      result->Success(flutter::EncodableValue(GetFunctionRegistryStats()));
+    } else if (call.method_name() == "runner.setFutureTracing") {
+      const auto* enabled = std::get_if<bool>(call.arguments());
+      BridgeTrace::Get().SetEnabled(enabled && *enabled);
+      result->Success(true);
+    } else if (call.method_name() == "runner.futureTrace") {
+      result->Success(flutter::EncodableValue(flutter::EncodableMap{
+        {flutter::EncodableValue("chromeTrace"), flutter::EncodableValue(BridgeTrace::Get().ExportChromeTrace())},
+        {flutter::EncodableValue("getCurrentUserIdToken"), flutter::EncodableValue(GetLatencyHistogram("auth.getCurrentUserIdToken"))},
+        {flutter::EncodableValue("requestIdToken"), flutter::EncodableValue(GetLatencyHistogram("user.getIdToken"))},
+        {flutter::EncodableValue("requestAppCheckToken"), flutter::EncodableValue(GetLatencyHistogram("appCheck.requestToken"))},
+      }));
     } else {
       result->NotImplemented();
     }
@@ -218,8 +291,8 @@ bool FlutterWindow::AddListener(firebase::App* app, void* callback, void* contex
   if (!instance) {
     return false;
   }
-  auto typed_callback = reinterpret_cast<FunctionRegistryCallback>(callback);
-  instance->callbacks.emplace_back(typed_callback, context);
+  auto typed_callback = reinterpret_cast<ListenerRegistry::Callback>(callback);
+  instance->auth_state_listeners_.Add(typed_callback, context);
   return true;
 }
 
@@ -227,13 +300,8 @@ bool FlutterWindow::RemoveListener(firebase::App* app, void* callback, void* con
   if (!instance) {
     return false;
   }
-  auto typed_callback = reinterpret_cast<FunctionRegistryCallback>(callback);
-  Entry entry = {typed_callback, context};
-
-  auto iterator = std::find(instance->callbacks.begin(), instance->callbacks.end(), entry);
-  if (iterator != instance->callbacks.end()) {
-    instance->callbacks.erase(iterator);
-  }
+  auto typed_callback = reinterpret_cast<ListenerRegistry::Callback>(callback);
+  instance->auth_state_listeners_.Remove(typed_callback, context);
   return true;
 }
 
@@ -251,34 +319,107 @@ bool FlutterWindow::GetCurrentUserIdToken(firebase::App* app, void* force_refres
 
   assert(force_refresh);
 
-  auto handle = instance->future()->SafeAlloc<std::string>(kFlutterWindowFnGetCurrentUserIdToken);
+  static metrics::Counter& calls = metrics::Registry::Get().GetCounter("auth.get_id_token.calls");
+  static metrics::Counter& shared_calls = metrics::Registry::Get().GetCounter("auth.get_id_token.shared");
+  static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("auth.get_id_token_us");
+  calls.Increment();
+
+  firebase::ReferenceCountedFutureImpl* api = instance->future();
+  firebase::SafeFutureHandle<std::string> handle;
+  {
+    firebase::MutexLock lock(api->mutex());
+    // Concurrent callers share the pending request.
+    if (!*in_force_refresh && api->LastResult(kFlutterWindowFnGetCurrentUserIdToken).status() == firebase::kFutureStatusPending) {
+      shared_calls.Increment();
+      if (out_future) {
+        firebase::FutureBase proxy = api->LastResultProxy(kFlutterWindowFnGetCurrentUserIdToken);
+        *out_future = static_cast<const firebase::Future<std::string>&>(proxy);
+      }
+      return true;
+    }
+    handle = api->SafeAlloc<std::string>(kFlutterWindowFnGetCurrentUserIdToken);
+  }
+  if (out_future) {
+    *out_future = firebase::Future<std::string>(api, handle.get());
+  }
+
+  // Calls back right away when the cached token is still valid. Otherwise,
+  // this runs on the platform thread, which mustn't run the callbacks of the
+  // future.
+  auto start = std::chrono::steady_clock::now();
+  instance->id_token_cache_.Get(
+    [api, handle, start](const TokenCache::Result& result) {
+      latency.Record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+      instance->callback_executor_.Post([api, handle, start, result]() {
+        BridgeTrace::Get().Record("auth.getCurrentUserIdToken", start, result.error);
+        if (result.error != 0) {
+          api->Complete(handle, result.error, result.error_message.c_str());
+        } else {
+          api->CompleteWithResult(handle, 0, result.token);
+        }
+      });
+    },
+    *in_force_refresh
+  );
+  return true;
+}
+
+void FlutterWindow::RequestIdToken(bool force_refresh, TokenCache::Callback callback) {
+  static metrics::Histogram& latency = metrics::Registry::Get().GetHistogram("auth.request_id_token_us");
+  static metrics::Counter& errors = metrics::Registry::Get().GetCounter("auth.request_id_token.errors");
+  if (!instance || !instance->method_channel_auth) {
+    TokenCache::Result result;
+    result.error = -2;
+    result.error_message = "Instance cannot be found.";
+    callback(result);
+    return;
+  }
 
   std::unique_ptr<flutter::EncodableValue> arguments = std::make_unique<flutter::EncodableValue>(flutter::EncodableMap{
-    {flutter::EncodableValue("forceRefresh"), flutter::EncodableValue(*in_force_refresh)},
+    {flutter::EncodableValue("forceRefresh"), flutter::EncodableValue(force_refresh)},
   });
 
+  // Times the round trip to Dart.
+  auto start = std::chrono::steady_clock::now();
+  auto record = [start](int error) {
+    latency.Record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    if (error != 0) {
+      errors.Increment();
+    }
+    BridgeTrace::Get().Record("user.getIdToken", start, error);
+  };
   std::unique_ptr<flutter::MethodResultFunctions<>> result_handler = std::make_unique<flutter::MethodResultFunctions<>>(
-    [handle](const flutter::EncodableValue* value) {
-      if (value == nullptr) {
-        instance->future()->Complete(handle, 0);
-      } else {
-        instance->future()->CompleteWithResult(handle, 0, std::get<std::string>(*value));
+    [callback, record](const flutter::EncodableValue* value) {
+      record(0);
+      TokenCache::Result result;
+      // No token when signed out, which isn't cached.
+      if (value != nullptr && std::holds_alternative<std::string>(*value)) {
+        result.token = std::get<std::string>(*value);
+        std::optional<int64_t> expiry = GetJwtExpiry(result.token);
+        if (expiry.has_value()) {
+          auto now = std::chrono::system_clock::now().time_since_epoch();
+          result.time_to_live = std::max(std::chrono::seconds(expiry.value()) - now, std::chrono::system_clock::duration::zero());
+        }
       }
+      callback(result);
     },
-    [handle](const std::string& error_code, const std::string& error_message, const void* error_details) {
-      instance->future()->Complete(handle, -1, error_message.c_str());
+    [callback, record](const std::string& error_code, const std::string& error_message, const void* error_details) {
+      TokenCache::Result result;
+      result.error = -1;
+      record(result.error);
+      result.error_message = error_message;
+      callback(result);
     },
-    [handle]() {
-      instance->future()->Complete(handle, -2, "Not implemented.");
+    [callback, record]() {
+      TokenCache::Result result;
+      result.error = -2;
+      record(result.error);
+      result.error_message = "Not implemented.";
+      callback(result);
     }
   );
 
   instance->method_channel_auth->InvokeMethod("user.getIdToken", std::move(arguments), std::move(result_handler));
-  if (out_future) {
-    *out_future = firebase::Future<std::string>(instance->future(), handle.get());
-  }
-
-  return true;
 }
 
 bool FlutterWindow::GetCurrentUserUid(firebase::App* app, void* /*unused*/, void* out) {
@@ -286,7 +427,11 @@ bool FlutterWindow::GetCurrentUserUid(firebase::App* app, void* /*unused*/, void
   if (out_string) {
     out_string->clear();
   }
-  if (!instance || !instance->user_uid.has_value()) {
+  if (!instance) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(instance->user_uid_mutex_);
+  if (!instance->user_uid.has_value()) {
     return false;
   }
   if (out_string) {
@@ -295,6 +440,53 @@ bool FlutterWindow::GetCurrentUserUid(firebase::App* app, void* /*unused*/, void
   return true;
 }
 
+flutter::EncodableMap FlutterWindow::GetLatencyHistogram(const char* name) {
+  BridgeTrace::LatencyHistogram histogram = BridgeTrace::Get().GetLatencyHistogram(name);
+  flutter::EncodableList buckets;
+  for (uint64_t bucket : histogram.buckets) {
+    buckets.emplace_back(static_cast<int64_t>(bucket));
+  }
+  return flutter::EncodableMap{
+    {flutter::EncodableValue("count"), flutter::EncodableValue(static_cast<int64_t>(histogram.count))},
+    {flutter::EncodableValue("totalNs"), flutter::EncodableValue(static_cast<int64_t>(histogram.total_ns))},
+    {flutter::EncodableValue("maxNs"), flutter::EncodableValue(static_cast<int64_t>(histogram.max_ns))},
+    {flutter::EncodableValue("buckets"), flutter::EncodableValue(buckets)},
+  };
+}
+
+template <firebase::internal::FunctionRegistry::RegisteredFunction Function>
+FlutterWindow::FunctionStats& FlutterWindow::GetFunctionStats() {
+  static FunctionStats stats;
+  return stats;
+}
+
+template <firebase::internal::FunctionRegistry::RegisteredFunction Function>
+bool FlutterWindow::CallCounted(firebase::App* app, void* args, void* out) {
+  auto start = std::chrono::steady_clock::now();
+  bool result = Function(app, args, out);
+  FunctionStats& stats = GetFunctionStats<Function>();
+  stats.calls.fetch_add(1, std::memory_order_relaxed);
+  stats.total_latency_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+  return result;
+}
+
+flutter::EncodableMap FlutterWindow::GetFunctionRegistryStats() {
+  const std::pair<const char*, FunctionStats*> functions[] = {
+    {"authAddAuthStateListener", &GetFunctionStats<AddListener>()},
+    {"authRemoveAuthStateListener", &GetFunctionStats<RemoveListener>()},
+    {"authGetTokenAsync", &GetFunctionStats<GetCurrentUserIdToken>()},
+    {"authGetCurrentUserUid", &GetFunctionStats<GetCurrentUserUid>()},
+  };
+  flutter::EncodableMap stats;
+  for (const auto& [name, function_stats] : functions) {
+    stats[flutter::EncodableValue(name)] = flutter::EncodableValue(flutter::EncodableMap{
+      {flutter::EncodableValue("calls"), flutter::EncodableValue(static_cast<int64_t>(function_stats->calls.load(std::memory_order_relaxed)))},
+      {flutter::EncodableValue("latencyNs"), flutter::EncodableValue(static_cast<int64_t>(function_stats->total_latency_ns.load(std::memory_order_relaxed)))},
+    });
+  }
+  return stats;
+}
+
 firebase::ReferenceCountedFutureImpl* FlutterWindow::future() {
   return future_manager().GetFutureApi(this);
 }
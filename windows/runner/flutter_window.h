@@ -8,21 +8,41 @@
 #include <flutter/flutter_view_controller.h>
 #include <flutter/method_channel.h>
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 
+#include "callback_executor.h"
+#include "listener_registry.h"
+#include "token_cache.h"
 #include "win32_window.h"
 
+#include "include/firebase/app/function_registry.h"
 #include "include/firebase/app/future_manager.h"
 #include "firebase/internal/future_impl.h"
 
 #include "firebase/app_check.h"
 
-using FunctionRegistryCallback = void (*)(void*);
+// How long before their expiry App Check tokens get refreshed.
+constexpr std::chrono::minutes kAppCheckTokenRefreshMargin(5);
+
+// How long before their expiry ID tokens get refreshed.
+constexpr std::chrono::minutes kIdTokenRefreshMargin(5);
 
 class PlatformAppCheckProvider : public firebase::app_check::AppCheckProvider {
  public:
+  PlatformAppCheckProvider();
+  // Returns the cached token, unless it's about to expire.
   void GetToken(std::function<void(firebase::app_check::AppCheckToken, int, const std::string&)> completion_callback) override;
   static std::string GetPublisher();
+
+ private:
+  // Requests a new token from Dart.
+  static void RequestToken(bool force_refresh, TokenCache::Callback callback);
+
+  TokenCache token_cache_;
 };
 
 class PlatformAppCheckProviderFactory : public firebase::app_check::AppCheckProviderFactory {
@@ -48,9 +68,17 @@ class FlutterWindow : public Win32Window {
   bool OnCreate() override;
   void OnDestroy() override;
   LRESULT MessageHandler(HWND window, UINT const message, WPARAM const wparam, LPARAM const lparam) noexcept override;
-  using Entry = std::pair<FunctionRegistryCallback, void*>;
 
  private:
+  // The auth state listeners of the Firebase SDK, notified when the user
+  // changes. Must outlive callback_executor_, which notifies them.
+  ListenerRegistry auth_state_listeners_;
+
+  // Completes our futures, so that their callbacks don't run on the platform
+  // thread answering method calls. Shut down before future_manager_ releases
+  // them.
+  CallbackExecutor callback_executor_;
+
   firebase::FutureManager future_manager_;
 
   firebase::FutureManager& future_manager() {
@@ -68,14 +96,43 @@ class FlutterWindow : public Win32Window {
   // The Flutter instance hosted by this window.
   std::unique_ptr<flutter::FlutterViewController> flutter_controller_;
 
+  // The current user UID, set by the platform thread and read by the SDK from
+  // any thread (eg. by auth state listeners run on |callback_executor_|).
+  std::mutex user_uid_mutex_;
   std::optional<std::string> user_uid;
 
+  // The current user ID token, invalidated when the user changes.
+  TokenCache id_token_cache_;
+
+  // Returns the latencies of the bridge calls named |name|, as recorded by
+  // BridgeTrace.
+  static flutter::EncodableMap GetLatencyHistogram(const char* name);
+
+  // The calls the SDK made to one of our functions through its function
+  // registry.
+  struct FunctionStats {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> total_latency_ns{0};
+  };
+
+  // Returns the stats of |Function|.
+  template <firebase::internal::FunctionRegistry::RegisteredFunction Function>
+  static FunctionStats& GetFunctionStats();
+
+  // Calls |Function|, counting the call and its latency. Registered in place
+  // of |Function|, as the registry belongs to the SDK.
+  template <firebase::internal::FunctionRegistry::RegisteredFunction Function>
+  static bool CallCounted(firebase::App* app, void* args, void* out);
+
+  // Returns the calls made through the function registry, by function.
+  static flutter::EncodableMap GetFunctionRegistryStats();
+
   static bool AddListener(firebase::App* app, void* callback, void* context);
   static bool RemoveListener(firebase::App* app, void* callback, void* context);
   static bool GetCurrentUserIdToken(firebase::App* app, void* force_refresh, void* out);
+  // Requests a new ID token from Dart.
+  static void RequestIdToken(bool force_refresh, TokenCache::Callback callback);
   static bool GetCurrentUserUid(firebase::App* app, void*, void* out);
-
-  std::vector<Entry> callbacks;
 };
 
 // Used by FlutterWindow functions that return a future
@@ -0,0 +1,44 @@
+#include "future_wait.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// Shared with the completion callback, which may run after the wait timed
+// out.
+struct Waiter {
+  std::mutex mutex;
+  std::condition_variable completed_changed;
+  bool completed = false;
+};
+
+}  // namespace
+
+firebase::FutureStatus WaitForFutureUntil(const firebase::FutureBase& future, std::chrono::steady_clock::time_point deadline) {
+  if (future.status() != firebase::kFutureStatusPending) {
+    return future.status();
+  }
+
+  auto waiter = std::make_shared<Waiter>();
+  // Runs right away if the future completed meanwhile.
+  firebase::FutureBase::CompletionCallbackHandle callback_handle = future.AddOnCompletion([waiter](const firebase::FutureBase&) {
+    std::lock_guard<std::mutex> lock(waiter->mutex);
+    waiter->completed = true;
+    waiter->completed_changed.notify_all();
+  });
+  bool completed;
+  {
+    std::unique_lock<std::mutex> lock(waiter->mutex);
+    completed = waiter->completed_changed.wait_until(lock, deadline, [&waiter]() { return waiter->completed; });
+  }
+  if (!completed) {
+    future.RemoveOnCompletion(callback_handle);
+  }
+  return future.status();
+}
+
+firebase::FutureStatus WaitForFuture(const firebase::FutureBase& future, std::chrono::steady_clock::duration timeout) {
+  return WaitForFutureUntil(future, std::chrono::steady_clock::now() + timeout);
+}
@@ -0,0 +1,25 @@
+#ifndef RUNNER_FUTURE_WAIT_H_
+#define RUNNER_FUTURE_WAIT_H_
+
+#include <chrono>
+
+#include "firebase/future.h"
+
+// Nothing in the runner waits on futures yet, as every token fetch completes
+// asynchronously, so this isn't built into it: it is only built by the tests
+// (see test/CMakeLists.txt), until a background thread needs it.
+
+// Blocks until |future| completes or |deadline| passes, whichever comes
+// first, and returns its status then. The calling thread sleeps on a
+// condition variable that only exists for the duration of the wait, and that
+// a completion callback signals, instead of polling status().
+//
+// Must not be called on the thread completing the future (eg. the platform
+// thread for futures completed by a method channel), which would only return
+// once the deadline passed.
+firebase::FutureStatus WaitForFutureUntil(const firebase::FutureBase& future, std::chrono::steady_clock::time_point deadline);
+
+// Same as above, with a timeout relative to now.
+firebase::FutureStatus WaitForFuture(const firebase::FutureBase& future, std::chrono::steady_clock::duration timeout);
+
+#endif  // RUNNER_FUTURE_WAIT_H_
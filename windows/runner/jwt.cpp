@@ -0,0 +1,99 @@
+#include "jwt.h"
+
+#include <cctype>
+#include <limits>
+
+namespace {
+
+// Decodes base64url, with or without padding. Returns nothing on invalid
+// characters, characters after the padding, or a truncated last quantum.
+std::optional<std::string> DecodeBase64Url(const std::string& input) {
+  size_t length = input.find('=');
+  if (length == std::string::npos) {
+    length = input.size();
+  } else if (input.size() - length > 2 || input.find_first_not_of('=', length) != std::string::npos) {
+    return std::nullopt;
+  }
+
+  std::string output;
+  output.reserve(length * 3 / 4);
+  uint32_t buffer = 0;
+  int bits = 0;
+  for (size_t index = 0; index < length; index++) {
+    char c = input[index];
+    int value;
+    if (c >= 'A' && c <= 'Z') {
+      value = c - 'A';
+    } else if (c >= 'a' && c <= 'z') {
+      value = c - 'a' + 26;
+    } else if (c >= '0' && c <= '9') {
+      value = c - '0' + 52;
+    } else if (c == '-' || c == '+') {
+      value = 62;
+    } else if (c == '_' || c == '/') {
+      value = 63;
+    } else {
+      return std::nullopt;
+    }
+    buffer = (buffer << 6) | static_cast<uint32_t>(value);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      output.push_back(static_cast<char>((buffer >> bits) & 0xFF));
+    }
+  }
+  // A single character left can't encode a byte.
+  if (bits >= 6) {
+    return std::nullopt;
+  }
+  return output;
+}
+
+}  // namespace
+
+std::optional<int64_t> GetJwtExpiry(const std::string& token) {
+  size_t payload_start = token.find('.');
+  if (payload_start == std::string::npos) {
+    return std::nullopt;
+  }
+  payload_start++;
+  size_t payload_end = token.find('.', payload_start);
+  if (payload_end == std::string::npos) {
+    return std::nullopt;
+  }
+  std::optional<std::string> payload = DecodeBase64Url(token.substr(payload_start, payload_end - payload_start));
+  if (!payload.has_value()) {
+    return std::nullopt;
+  }
+
+  // The payload is a flat JSON object, so looking for the key followed by a
+  // colon is enough. A string value equal to "exp" isn't followed by one.
+  for (size_t key = payload->find("\"exp\""); key != std::string::npos; key = payload->find("\"exp\"", key + 1)) {
+    size_t position = key + 5;
+    while (position < payload->size() && std::isspace(static_cast<unsigned char>((*payload)[position]))) {
+      position++;
+    }
+    if (position == payload->size() || (*payload)[position] != ':') {
+      continue;
+    }
+    position++;
+    while (position < payload->size() && std::isspace(static_cast<unsigned char>((*payload)[position]))) {
+      position++;
+    }
+    int64_t expiry = 0;
+    size_t digits_start = position;
+    while (position < payload->size() && std::isdigit(static_cast<unsigned char>((*payload)[position]))) {
+      int digit = (*payload)[position] - '0';
+      if (expiry > (std::numeric_limits<int64_t>::max() - digit) / 10) {
+        return std::nullopt;
+      }
+      expiry = expiry * 10 + digit;
+      position++;
+    }
+    if (position == digits_start) {
+      return std::nullopt;
+    }
+    return expiry;
+  }
+  return std::nullopt;
+}
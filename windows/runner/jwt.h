@@ -0,0 +1,12 @@
+#ifndef RUNNER_JWT_H_
+#define RUNNER_JWT_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Returns the "exp" claim of a JWT, in seconds since the epoch, or nothing if
+// the token can't be decoded. The signature isn't verified.
+std::optional<int64_t> GetJwtExpiry(const std::string& token);
+
+#endif  // RUNNER_JWT_H_
@@ -0,0 +1,108 @@
+#include "listener_registry.h"
+
+#include <utility>
+
+ListenerRegistry::ListenerRegistry(Dispatcher dispatcher)
+  : dispatcher_(std::move(dispatcher)) {}
+
+ListenerRegistry::Handle ListenerRegistry::Add(Callback callback, void* context) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Key key = {callback, context};
+  auto found = handles_.find(key);
+  if (found != handles_.end()) {
+    return found->second;
+  }
+
+  uint32_t index;
+  if (!free_slots_.empty()) {
+    index = free_slots_.back();
+    free_slots_.pop_back();
+  } else {
+    index = static_cast<uint32_t>(slots_.size());
+    slots_.emplace_back();
+  }
+  Slot& slot = slots_[index];
+  slot.callback = callback;
+  slot.context = context;
+  slot.active = true;
+  slot.added_epoch = epoch_;
+  Handle handle = MakeHandle(index, slot.generation);
+  handles_.emplace(key, handle);
+  return handle;
+}
+
+bool ListenerRegistry::Remove(Handle handle) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint32_t index = static_cast<uint32_t>(handle);
+  uint32_t generation = static_cast<uint32_t>(handle >> 32);
+  if (index >= slots_.size() || !slots_[index].active || slots_[index].generation != generation) {
+    return false;
+  }
+  handles_.erase(Key{slots_[index].callback, slots_[index].context});
+  FreeSlot(lock, index);
+  return true;
+}
+
+bool ListenerRegistry::Remove(Callback callback, void* context) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto found = handles_.find(Key{callback, context});
+  if (found == handles_.end()) {
+    return false;
+  }
+  uint32_t index = static_cast<uint32_t>(found->second);
+  handles_.erase(found);
+  FreeSlot(lock, index);
+  return true;
+}
+
+size_t ListenerRegistry::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return handles_.size();
+}
+
+void ListenerRegistry::FreeSlot(std::unique_lock<std::mutex>& lock, uint32_t index) {
+  // The slot is out of |handles_|, so no one else frees it meanwhile.
+  slots_[index].active = false;
+  notified_slot_changed_.wait(lock, [this, index]() {
+    return notified_slot_ != index || notifying_thread_ == std::this_thread::get_id();
+  });
+  Slot& slot = slots_[index];
+  slot.callback = nullptr;
+  slot.context = nullptr;
+  slot.generation++;
+  free_slots_.push_back(index);
+}
+
+void ListenerRegistry::Notify() {
+  if (dispatcher_) {
+    dispatcher_([this]() { NotifyNow(); });
+  } else {
+    NotifyNow();
+  }
+}
+
+void ListenerRegistry::NotifyNow() {
+  std::lock_guard<std::recursive_mutex> notify_lock(notify_mutex_);
+  std::unique_lock<std::mutex> lock(mutex_);
+  uint64_t epoch = ++epoch_;
+  // Restored once done, in case this is a nested notification.
+  uint32_t previous_notified_slot = notified_slot_;
+  notifying_thread_ = std::this_thread::get_id();
+  // Slots are looked up again after each call, as listeners may have
+  // changed them.
+  for (size_t index = 0; index < slots_.size(); index++) {
+    const Slot& slot = slots_[index];
+    if (!slot.active || slot.added_epoch >= epoch) {
+      continue;
+    }
+    Callback callback = slot.callback;
+    void* context = slot.context;
+    notified_slot_ = static_cast<uint32_t>(index);
+    lock.unlock();
+    callback(context);
+    lock.lock();
+    notified_slot_ = kNoSlot;
+    notified_slot_changed_.notify_all();
+  }
+  notified_slot_ = previous_notified_slot;
+}
@@ -0,0 +1,106 @@
+#ifndef RUNNER_LISTENER_REGISTRY_H_
+#define RUNNER_LISTENER_REGISTRY_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Listeners registered as a callback and its context, notified all at once
+// (eg. the auth state listeners of the Firebase SDK). It doesn't depend on
+// Flutter nor Firebase, so that it can be used by any runner.
+//
+// Adding and removing a listener are O(1). Listeners can add or remove
+// listeners while being notified: removed ones aren't notified anymore, and
+// added ones are only notified from the next notification on. Removing a
+// listener being notified by another thread waits for it to return, so that
+// its context can be deleted right after.
+class ListenerRegistry {
+ public:
+  using Callback = void (*)(void* context);
+  // Identifies a registered listener. Handles of removed listeners are never
+  // reused.
+  using Handle = uint64_t;
+  // Runs a notification, possibly on another thread.
+  using Dispatcher = std::function<void(std::function<void()> notification)>;
+
+  // Notifications run on the thread calling Notify(), unless a |dispatcher|
+  // is given.
+  explicit ListenerRegistry(Dispatcher dispatcher = nullptr);
+  ListenerRegistry(ListenerRegistry const&) = delete;
+  void operator=(ListenerRegistry const&) = delete;
+
+  // Adds a listener, unless it's already registered. Returns its handle.
+  Handle Add(Callback callback, void* context);
+
+  // Removes a listener. Returns whether it was registered.
+  bool Remove(Handle handle);
+  bool Remove(Callback callback, void* context);
+
+  // Returns the number of registered listeners.
+  size_t size();
+
+  // Calls every registered listener, through the dispatcher if there's one.
+  void Notify();
+
+ private:
+  struct Slot {
+    Callback callback = nullptr;
+    void* context = nullptr;
+    // Incremented each time the slot is freed, so that stale handles don't
+    // match a reused slot.
+    uint32_t generation = 0;
+    bool active = false;
+    // Value of |epoch_| when the listener was added.
+    uint64_t added_epoch = 0;
+  };
+
+  struct Key {
+    Callback callback;
+    void* context;
+    bool operator==(const Key& other) const {
+      return callback == other.callback && context == other.context;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return std::hash<void*>()(reinterpret_cast<void*>(key.callback)) * 31 + std::hash<void*>()(key.context);
+    }
+  };
+
+  static Handle MakeHandle(uint32_t index, uint32_t generation) {
+    return (static_cast<Handle>(generation) << 32) | index;
+  }
+
+  // Waits until the slot at |index| isn't being notified by another thread,
+  // then frees it.
+  void FreeSlot(std::unique_lock<std::mutex>& lock, uint32_t index);
+
+  // Calls the listeners registered before this notification.
+  void NotifyNow();
+
+  static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+  Dispatcher dispatcher_;
+
+  // Serializes notifications. Recursive, as listeners may notify too.
+  std::recursive_mutex notify_mutex_;
+
+  std::mutex mutex_;
+  // Slot whose listener is being called, and by which thread.
+  uint32_t notified_slot_ = kNoSlot;
+  std::thread::id notifying_thread_;
+  std::condition_variable notified_slot_changed_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> free_slots_;
+  std::unordered_map<Key, Handle, KeyHash> handles_;
+  // Incremented by each notification.
+  uint64_t epoch_ = 0;
+};
+
+#endif  // RUNNER_LISTENER_REGISTRY_H_
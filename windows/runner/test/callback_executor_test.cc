@@ -0,0 +1,75 @@
+#include "callback_executor.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+void TestRunsTasksInOrderOnAnotherThread() {
+  std::vector<int> order;
+  std::atomic<bool> other_thread{true};
+  std::thread::id caller = std::this_thread::get_id();
+  {
+    CallbackExecutor executor;
+    for (int index = 0; index < 100; index++) {
+      executor.Post([&order, &other_thread, caller, index]() {
+        if (std::this_thread::get_id() == caller) {
+          other_thread = false;
+        }
+        order.push_back(index);
+      });
+    }
+  }
+  EXPECT(other_thread);
+  EXPECT_EQ(order.size(), 100u);
+  for (int index = 0; index < static_cast<int>(order.size()); index++) {
+    EXPECT_EQ(order[index], index);
+  }
+}
+
+void TestShutdownRunsRemainingTasks() {
+  CallbackExecutor executor(4);
+  std::atomic<int> run{0};
+  for (int index = 0; index < 1000; index++) {
+    executor.Post([&run]() { run++; });
+  }
+  executor.Shutdown();
+  EXPECT_EQ(run.load(), 1000);
+
+  // Once shut down, tasks run inline.
+  bool inline_run = false;
+  executor.Post([&inline_run]() { inline_run = true; });
+  EXPECT(inline_run);
+}
+
+void TestRunsTasksInlineWithoutThreads() {
+  CallbackExecutor executor(0);
+  bool run = false;
+  executor.Post([&run]() { run = true; });
+  EXPECT(run);
+}
+
+void TestTasksCanPostTasks() {
+  std::atomic<int> run{0};
+  {
+    CallbackExecutor executor;
+    executor.Post([&executor, &run]() {
+      run++;
+      executor.Post([&run]() { run++; });
+    });
+  }
+  EXPECT_EQ(run.load(), 2);
+}
+
+}  // namespace
+
+int main() {
+  TestRunsTasksInOrderOnAnotherThread();
+  TestShutdownRunsRemainingTasks();
+  TestRunsTasksInlineWithoutThreads();
+  TestTasksCanPostTasks();
+  return TestExitCode();
+}
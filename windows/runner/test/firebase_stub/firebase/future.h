@@ -0,0 +1,134 @@
+#ifndef RUNNER_TEST_FIREBASE_STUB_FUTURE_H_
+#define RUNNER_TEST_FIREBASE_STUB_FUTURE_H_
+
+// The parts of the public firebase/future.h of the Firebase C++ SDK that the
+// vendored future runtime and the runner use, so that they build on Linux
+// without the SDK. Declarations match the SDK, with INTERNAL_EXPERIMENTAL
+// defined.
+
+#include <cstdint>
+#include <functional>
+
+#include "firebase/internal/common.h"
+
+namespace firebase {
+
+enum FutureStatus {
+  kFutureStatusComplete,
+  kFutureStatusPending,
+  kFutureStatusInvalid,
+};
+
+typedef uintptr_t FutureHandleId;
+
+class FutureBase;
+
+namespace detail {
+
+class FutureApiInterface;
+
+// Members are private in the SDK, which befriends their users instead.
+class CompletionCallbackHandle {
+ public:
+  CompletionCallbackHandle()
+      : callback_(nullptr), user_data_(nullptr), user_data_delete_fn_(nullptr) {}
+  CompletionCallbackHandle(void (*callback)(const FutureBase& future, void* user_data), void* user_data, void (*user_data_delete_fn)(void*))
+      : callback_(callback), user_data_(user_data), user_data_delete_fn_(user_data_delete_fn) {}
+
+  void (*callback_)(const FutureBase& future, void* user_data);
+  void* user_data_;
+  void (*user_data_delete_fn_)(void*);
+};
+
+}  // namespace detail
+
+// Implemented by the vendored reference_counted_future_impl.cpp.
+class FutureHandle {
+ public:
+  FutureHandle();
+  explicit FutureHandle(FutureHandleId id) : FutureHandle(id, nullptr) {}
+  FutureHandle(FutureHandleId id, detail::FutureApiInterface* api);
+  ~FutureHandle();
+  FutureHandle(const FutureHandle& rhs);
+  FutureHandle& operator=(const FutureHandle& rhs);
+  FutureHandle(FutureHandle&& rhs) noexcept;
+  FutureHandle& operator=(FutureHandle&& rhs) noexcept;
+
+  FutureHandleId id() const { return id_; }
+  bool operator!=(const FutureHandle& rhs) const { return !(*this == rhs); }
+  bool operator==(const FutureHandle& rhs) const { return id() == rhs.id(); }
+
+  // Private in the SDK, which befriends their users instead.
+  void Detach();
+  void Cleanup() { api_ = nullptr; }
+
+ private:
+  FutureHandleId id_;
+  detail::FutureApiInterface* api_;
+};
+
+namespace detail {
+
+class FutureApiInterface {
+ public:
+  virtual ~FutureApiInterface();
+  virtual void ReferenceFuture(const FutureHandle& handle) = 0;
+  virtual void ReleaseFuture(const FutureHandle& handle) = 0;
+  virtual FutureStatus GetFutureStatus(const FutureHandle& handle) const = 0;
+  virtual int GetFutureError(const FutureHandle& handle) const = 0;
+  virtual const char* GetFutureErrorMessage(const FutureHandle& handle) const = 0;
+  virtual const void* GetFutureResult(const FutureHandle& handle) const = 0;
+  virtual CompletionCallbackHandle AddCompletionCallback(const FutureHandle& handle, void (*callback)(const FutureBase& future, void* user_data), void* user_data, void (*user_data_delete_fn)(void*), bool single_completion) = 0;
+  virtual void RemoveCompletionCallback(const FutureHandle& handle, CompletionCallbackHandle callback_handle) = 0;
+  virtual CompletionCallbackHandle AddCompletionCallbackLambda(const FutureHandle& handle, std::function<void(const FutureBase&)> callback, bool single_completion) = 0;
+  virtual void RegisterFutureForCleanup(FutureBase* future) = 0;
+  virtual void UnregisterFutureForCleanup(FutureBase* future) = 0;
+};
+
+}  // namespace detail
+
+// Implemented by firebase_stub.cc, like the SDK's future_impl.h does.
+class FutureBase {
+ public:
+  typedef void (*CompletionCallback)(const FutureBase& result_data, void* user_data);
+  using CompletionCallbackHandle = detail::CompletionCallbackHandle;
+
+  FutureBase();
+  FutureBase(detail::FutureApiInterface* api, const FutureHandle& handle);
+  ~FutureBase();
+  FutureBase(const FutureBase& rhs);
+  FutureBase& operator=(const FutureBase& rhs);
+
+  void Release();
+  FutureStatus status() const;
+  int error() const;
+  const char* error_message() const;
+  const void* result_void() const;
+
+  void OnCompletion(CompletionCallback callback, void* user_data) const;
+  void OnCompletion(std::function<void(const FutureBase&)> callback) const;
+  CompletionCallbackHandle AddOnCompletion(CompletionCallback callback, void* user_data) const;
+  CompletionCallbackHandle AddOnCompletion(std::function<void(const FutureBase&)> callback) const;
+  void RemoveOnCompletion(CompletionCallbackHandle completion_handle) const;
+
+  bool operator==(const FutureBase& rhs) const { return api_ == rhs.api_ && handle_ == rhs.handle_; }
+
+  const FutureHandle& GetHandle() const { return handle_; }
+
+ private:
+  detail::FutureApiInterface* api_;
+  FutureHandle handle_;
+};
+
+template <typename ResultType>
+class Future : public FutureBase {
+ public:
+  Future() {}
+  Future(detail::FutureApiInterface* api, const FutureHandle& handle) : FutureBase(api, handle) {}
+
+  const ResultType* result() const { return static_cast<const ResultType*>(result_void()); }
+};
+
+}  // namespace firebase
+
+#endif  // RUNNER_TEST_FIREBASE_STUB_FUTURE_H_
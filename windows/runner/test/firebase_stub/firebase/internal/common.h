@@ -0,0 +1,11 @@
+#ifndef RUNNER_TEST_FIREBASE_STUB_INTERNAL_COMMON_H_
+#define RUNNER_TEST_FIREBASE_STUB_INTERNAL_COMMON_H_
+
+// The feature macros firebase/internal/common.h of the Firebase C++ SDK
+// defines for a C++11 compiler.
+
+#define FIREBASE_DEPRECATED __attribute__((deprecated))
+#define FIREBASE_USE_STD_FUNCTION
+#define FIREBASE_USE_MOVE_OPERATORS
+
+#endif  // RUNNER_TEST_FIREBASE_STUB_INTERNAL_COMMON_H_
@@ -0,0 +1,43 @@
+#ifndef RUNNER_TEST_FIREBASE_STUB_INTERNAL_MUTEX_H_
+#define RUNNER_TEST_FIREBASE_STUB_INTERNAL_MUTEX_H_
+
+// firebase/internal/mutex.h of the Firebase C++ SDK, whose Mutex is
+// recursive by default.
+
+#include <mutex>
+
+namespace firebase {
+
+class Mutex {
+ public:
+  enum Mode {
+    kModeNonRecursive = 0,
+    kModeRecursive = 1,
+  };
+
+  Mutex() {}
+  explicit Mutex(Mode /*mode*/) {}
+  Mutex(const Mutex&) = delete;
+  Mutex& operator=(const Mutex&) = delete;
+
+  void Acquire() { mutex_.lock(); }
+  void Release() { mutex_.unlock(); }
+
+ private:
+  std::recursive_mutex mutex_;
+};
+
+class MutexLock {
+ public:
+  explicit MutexLock(Mutex& mutex) : mutex_(&mutex) { mutex_->Acquire(); }
+  ~MutexLock() { mutex_->Release(); }
+  MutexLock(const MutexLock&) = delete;
+  MutexLock& operator=(const MutexLock&) = delete;
+
+ private:
+  Mutex* mutex_;
+};
+
+}  // namespace firebase
+
+#endif  // RUNNER_TEST_FIREBASE_STUB_INTERNAL_MUTEX_H_
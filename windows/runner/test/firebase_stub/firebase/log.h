@@ -0,0 +1,19 @@
+#ifndef RUNNER_TEST_FIREBASE_STUB_LOG_H_
+#define RUNNER_TEST_FIREBASE_STUB_LOG_H_
+
+// The public firebase/log.h of the Firebase C++ SDK.
+
+namespace firebase {
+
+enum LogLevel {
+  kLogLevelVerbose = 0,
+  kLogLevelDebug,
+  kLogLevelInfo,
+  kLogLevelWarning,
+  kLogLevelError,
+  kLogLevelAssert,
+};
+
+}  // namespace firebase
+
+#endif  // RUNNER_TEST_FIREBASE_STUB_LOG_H_
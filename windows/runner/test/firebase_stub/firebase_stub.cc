@@ -0,0 +1,122 @@
+// Implements the parts of the Firebase C++ SDK that the vendored future
+// runtime uses but doesn't define: FutureBase, like the SDK's
+// firebase/internal/future_impl.h, and logging.
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+#include "firebase/future.h"
+#include "log.h"
+
+namespace firebase {
+
+FutureBase::FutureBase() : api_(nullptr), handle_(0) {}
+
+FutureBase::FutureBase(detail::FutureApiInterface* api, const FutureHandle& handle) : api_(api), handle_(handle) {
+  api_->ReferenceFuture(handle_);
+  // Once the FutureBase has a reference, the handle doesn't need one.
+  handle_.Detach();
+  api_->RegisterFutureForCleanup(this);
+}
+
+FutureBase::~FutureBase() {
+  Release();
+}
+
+FutureBase::FutureBase(const FutureBase& rhs) : api_(nullptr) {
+  *this = rhs;
+}
+
+FutureBase& FutureBase::operator=(const FutureBase& rhs) {
+  if (this == &rhs) {
+    return *this;
+  }
+  Release();
+  api_ = rhs.api_;
+  handle_ = FutureHandle(rhs.handle_.id());
+  if (api_ != nullptr) {
+    api_->ReferenceFuture(handle_);
+    api_->RegisterFutureForCleanup(this);
+  }
+  return *this;
+}
+
+void FutureBase::Release() {
+  if (api_ != nullptr) {
+    api_->UnregisterFutureForCleanup(this);
+    detail::FutureApiInterface* api = api_;
+    api_ = nullptr;
+    api->ReleaseFuture(handle_);
+  }
+}
+
+FutureStatus FutureBase::status() const {
+  return api_ == nullptr ? kFutureStatusInvalid : api_->GetFutureStatus(handle_);
+}
+
+int FutureBase::error() const {
+  return api_ == nullptr ? -1 : api_->GetFutureError(handle_);
+}
+
+const char* FutureBase::error_message() const {
+  return api_ == nullptr ? nullptr : api_->GetFutureErrorMessage(handle_);
+}
+
+const void* FutureBase::result_void() const {
+  return api_ == nullptr ? nullptr : api_->GetFutureResult(handle_);
+}
+
+void FutureBase::OnCompletion(CompletionCallback callback, void* user_data) const {
+  if (api_ != nullptr) {
+    api_->AddCompletionCallback(handle_, callback, user_data, nullptr, true);
+  }
+}
+
+void FutureBase::OnCompletion(std::function<void(const FutureBase&)> callback) const {
+  if (api_ != nullptr) {
+    api_->AddCompletionCallbackLambda(handle_, std::move(callback), true);
+  }
+}
+
+FutureBase::CompletionCallbackHandle FutureBase::AddOnCompletion(CompletionCallback callback, void* user_data) const {
+  return api_ == nullptr ? CompletionCallbackHandle() : api_->AddCompletionCallback(handle_, callback, user_data, nullptr, false);
+}
+
+FutureBase::CompletionCallbackHandle FutureBase::AddOnCompletion(std::function<void(const FutureBase&)> callback) const {
+  return api_ == nullptr ? CompletionCallbackHandle() : api_->AddCompletionCallbackLambda(handle_, std::move(callback), false);
+}
+
+void FutureBase::RemoveOnCompletion(CompletionCallbackHandle completion_handle) const {
+  if (api_ != nullptr) {
+    api_->RemoveCompletionCallback(handle_, completion_handle);
+  }
+}
+
+void LogMessageV(LogLevel log_level, const char* format, va_list args) {
+  std::vfprintf(stderr, format, args);
+  std::fputc('\n', stderr);
+  if (log_level == kLogLevelAssert) {
+    std::abort();
+  }
+}
+
+void LogMessageWithCallbackV(LogLevel log_level, const char* format, va_list args) {
+  LogMessageV(log_level, format, args);
+}
+
+#define RUNNER_TEST_DEFINE_LOG(name, level) \
+  void name(const char* format, ...) {      \
+    va_list args;                           \
+    va_start(args, format);                 \
+    LogMessageV(level, format, args);       \
+    va_end(args);                           \
+  }
+
+RUNNER_TEST_DEFINE_LOG(LogDebug, kLogLevelDebug)
+RUNNER_TEST_DEFINE_LOG(LogInfo, kLogLevelInfo)
+RUNNER_TEST_DEFINE_LOG(LogWarning, kLogLevelWarning)
+RUNNER_TEST_DEFINE_LOG(LogError, kLogLevelError)
+RUNNER_TEST_DEFINE_LOG(LogAssert, kLogLevelAssert)
+
+}  // namespace firebase
@@ -0,0 +1,236 @@
+// Measures the throughput of the vendored future runtime: the
+// ReferenceCountedFutureImpl, FutureManager and CleanupNotifier the runner's
+// futures go through. Results are written in the JSON format of Google
+// Benchmark, so that runs of different releases can be compared with its
+// tools (eg. compare.py).
+//
+// Usage: future_benchmark [--quick] [--out=<file>]
+//   --quick: runs a few iterations only, to check that it works.
+//   --out: writes the JSON to <file> instead of the standard output.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "firebase/future.h"
+#include "future_manager.h"
+#include "reference_counted_future_impl.h"
+
+namespace {
+
+struct Result {
+  std::string name;
+  int64_t iterations;
+  double real_time_ns;
+  double cpu_time_ns;
+};
+
+// Divides the iteration counts, with --quick.
+int64_t g_scale = 1;
+
+std::vector<Result> g_results;
+
+// Runs |body| once for |iterations| iterations, and records the time per
+// iteration.
+template <typename Body>
+void Run(const std::string& name, int64_t iterations, Body body) {
+  iterations = std::max<int64_t>(iterations / g_scale, 1);
+  std::clock_t cpu_start = std::clock();
+  auto start = std::chrono::steady_clock::now();
+  body(iterations);
+  auto real_time = std::chrono::steady_clock::now() - start;
+  std::clock_t cpu_time = std::clock() - cpu_start;
+  g_results.push_back({
+    name,
+    iterations,
+    std::chrono::duration<double, std::nano>(real_time).count() / iterations,
+    static_cast<double>(cpu_time) * 1e9 / CLOCKS_PER_SEC / iterations,
+  });
+  std::cerr << name << ": " << g_results.back().real_time_ns << " ns" << std::endl;
+}
+
+void NoOpCallback(const firebase::FutureBase& /*future*/, void* /*user_data*/) {}
+
+// Allocates a future, hands it out, completes it, then drops it.
+void BenchmarkAllocCompleteRelease() {
+  Run("BM_AllocCompleteRelease", 1000000, [](int64_t iterations) {
+    firebase::ReferenceCountedFutureImpl api(1);
+    for (int64_t i = 0; i < iterations; i++) {
+      firebase::SafeFutureHandle<int> handle = api.SafeAlloc<int>(0);
+      firebase::Future<int> future = firebase::MakeFuture(&api, handle);
+      api.CompleteWithResult(handle, 0, static_cast<int>(i));
+    }
+  });
+}
+
+// Completes futures with |callback_count| completion callbacks each.
+void BenchmarkCallbackFanOut(int callback_count) {
+  Run("BM_CallbackFanOut/" + std::to_string(callback_count), 200000, [callback_count](int64_t iterations) {
+    firebase::ReferenceCountedFutureImpl api(0);
+    for (int64_t i = 0; i < iterations; i++) {
+      firebase::SafeFutureHandle<int> handle = api.SafeAlloc<int>();
+      firebase::Future<int> future = firebase::MakeFuture(&api, handle);
+      for (int callback = 0; callback < callback_count; callback++) {
+        future.AddOnCompletion(NoOpCallback, nullptr);
+      }
+      api.CompleteWithResult(handle, 0, 0);
+    }
+  });
+}
+
+// Copies a handle, which registers and unregisters it with the
+// CleanupNotifier of its API.
+void BenchmarkFutureHandleCopy() {
+  Run("BM_FutureHandleCopy", 2000000, [](int64_t iterations) {
+    firebase::ReferenceCountedFutureImpl api(0);
+    firebase::SafeFutureHandle<int> handle = api.SafeAlloc<int>();
+    for (int64_t i = 0; i < iterations; i++) {
+      firebase::FutureHandle copy(handle.get());
+    }
+    api.CompleteWithResult(handle, 0, 0);
+  });
+}
+
+// Completes futures from |completer_count| threads, while as many threads
+// poll the status of the futures of the API.
+void BenchmarkCompleteWhilePolling(int completer_count) {
+  Run("BM_CompleteWhilePolling/threads:" + std::to_string(completer_count), 200000, [completer_count](int64_t iterations) {
+    firebase::ReferenceCountedFutureImpl api(1);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> pollers;
+    for (int poller = 0; poller < completer_count; poller++) {
+      pollers.emplace_back([&api, &done]() {
+        firebase::SafeFutureHandle<int> handle = api.SafeAlloc<int>();
+        firebase::Future<int> future = firebase::MakeFuture(&api, handle);
+        while (!done.load(std::memory_order_relaxed)) {
+          future.status();
+        }
+        api.CompleteWithResult(handle, 0, 0);
+      });
+    }
+    std::vector<std::thread> completers;
+    for (int completer = 0; completer < completer_count; completer++) {
+      completers.emplace_back([&api, iterations, completer_count]() {
+        for (int64_t i = 0; i < iterations / completer_count; i++) {
+          firebase::SafeFutureHandle<int> handle = api.SafeAlloc<int>();
+          firebase::Future<int> future = firebase::MakeFuture(&api, handle);
+          api.CompleteWithResult(handle, 0, 0);
+        }
+      });
+    }
+    for (std::thread& completer : completers) {
+      completer.join();
+    }
+    done = true;
+    for (std::thread& poller : pollers) {
+      poller.join();
+    }
+  });
+}
+
+// Releases |api_count| APIs with a pending future each, which orphans them,
+// then completes the futures and reclaims the APIs. Each release looks for
+// orphans to reclaim.
+void BenchmarkOrphanCleanup(int api_count) {
+  Run("BM_OrphanCleanup/apis:" + std::to_string(api_count), api_count, [](int64_t iterations) {
+    firebase::FutureManager manager;
+    std::vector<int> owners(iterations);
+    std::vector<firebase::ReferenceCountedFutureImpl*> apis;
+    std::vector<firebase::SafeFutureHandle<int>> handles;
+    std::vector<firebase::Future<int>> futures;
+    for (int& owner : owners) {
+      manager.AllocFutureApi(&owner, 1);
+      apis.push_back(manager.GetFutureApi(&owner));
+      handles.push_back(apis.back()->SafeAlloc<int>(0));
+      futures.push_back(firebase::MakeFuture(apis.back(), handles.back()));
+    }
+    for (int& owner : owners) {
+      manager.ReleaseFutureApi(&owner);
+    }
+    for (size_t index = 0; index < apis.size(); index++) {
+      apis[index]->CompleteWithResult(handles[index], 0, 0);
+    }
+    handles.clear();
+    futures.clear();
+    manager.CleanupOrphanedFutureApis();
+  });
+}
+
+std::string ToJson() {
+  std::ostringstream json;
+  std::time_t now = std::time(nullptr);
+  char date[32];
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+  json << "{\n  \"context\": {\n";
+  json << "    \"date\": \"" << date << "\",\n";
+  json << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#if defined(NDEBUG)
+  json << "    \"library_build_type\": \"release\"\n";
+#else
+  json << "    \"library_build_type\": \"debug\"\n";
+#endif
+  json << "  },\n  \"benchmarks\": [\n";
+  for (size_t index = 0; index < g_results.size(); index++) {
+    const Result& result = g_results[index];
+    json << "    {\n";
+    json << "      \"name\": \"" << result.name << "\",\n";
+    json << "      \"run_name\": \"" << result.name << "\",\n";
+    json << "      \"run_type\": \"iteration\",\n";
+    json << "      \"iterations\": " << result.iterations << ",\n";
+    json << "      \"real_time\": " << result.real_time_ns << ",\n";
+    json << "      \"cpu_time\": " << result.cpu_time_ns << ",\n";
+    json << "      \"time_unit\": \"ns\"\n";
+    json << "    }" << (index + 1 < g_results.size() ? "," : "") << "\n";
+  }
+  json << "  ]\n}\n";
+  return json.str();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string out;
+  for (int index = 1; index < argc; index++) {
+    std::string argument(argv[index]);
+    if (argument == "--quick") {
+      g_scale = 1000;
+    } else if (argument.rfind("--out=", 0) == 0) {
+      out = argument.substr(6);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--quick] [--out=<file>]" << std::endl;
+      return 2;
+    }
+  }
+
+  BenchmarkAllocCompleteRelease();
+  BenchmarkCallbackFanOut(1);
+  BenchmarkCallbackFanOut(8);
+  BenchmarkFutureHandleCopy();
+  BenchmarkCompleteWhilePolling(1);
+  BenchmarkCompleteWhilePolling(4);
+  BenchmarkOrphanCleanup(100);
+  BenchmarkOrphanCleanup(1000);
+  BenchmarkOrphanCleanup(5000);
+
+  std::string json = ToJson();
+  if (out.empty()) {
+    std::cout << json;
+  } else {
+    std::ofstream file(out);
+    file << json;
+    if (!file) {
+      std::cerr << "Cannot write " << out << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,265 @@
+// Hammers the vendored future runtime from many threads with randomized
+// allocations, completions, releases, copies and callback registrations, and
+// orphans APIs while their futures are still pending or running callbacks.
+// Meant to be built with -DRUNNER_TEST_SANITIZER=thread or address, which
+// report the races and use-after-frees the expectations can't see.
+//
+// Usage: future_stress_test [<iterations per thread>]
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "firebase/future.h"
+#include "future_manager.h"
+#include "reference_counted_future_impl.h"
+#include "test.h"
+
+namespace {
+
+constexpr int kThreadCount = 8;
+
+int g_iterations = 20000;
+
+// A future handed out to the threads, with its handle so that any of them
+// can complete it.
+struct PendingFuture {
+  firebase::ReferenceCountedFutureImpl* api;
+  firebase::SafeFutureHandle<int> handle;
+  firebase::Future<int> future;
+  int value;
+};
+
+// Futures shared by the threads of a test.
+class Pool {
+ public:
+  void Add(PendingFuture future) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    futures_.push_back(std::move(future));
+  }
+
+  // Removes a random future, returning whether there was one.
+  bool Take(std::mt19937& random, PendingFuture& future) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (futures_.empty()) {
+      return false;
+    }
+    size_t index = random() % futures_.size();
+    future = std::move(futures_[index]);
+    futures_[index] = std::move(futures_.back());
+    futures_.pop_back();
+    return true;
+  }
+
+  // Copies a random future, returning whether there was one.
+  bool Copy(std::mt19937& random, firebase::Future<int>& future) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (futures_.empty()) {
+      return false;
+    }
+    future = futures_[random() % futures_.size()].future;
+    return true;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<PendingFuture> futures_;
+};
+
+// Counts the callbacks added, and checks that each runs once, after its
+// future completed with the right result.
+struct CallbackCounter {
+  std::atomic<int> added{0};
+  std::atomic<int> run{0};
+  std::atomic<int> wrong_results{0};
+
+  void Add(const firebase::Future<int>& future, int expected_value) {
+    added++;
+    future.AddOnCompletion([this, expected_value](const firebase::FutureBase& completed) {
+      const auto& typed = static_cast<const firebase::Future<int>&>(completed);
+      if (completed.status() != firebase::kFutureStatusComplete || typed.result() == nullptr || *typed.result() != expected_value) {
+        wrong_results++;
+      }
+      // Copying and releasing the future while the API runs callbacks with
+      // its mutex dropped.
+      firebase::FutureBase copy = completed;
+      copy.Release();
+      run++;
+    });
+  }
+};
+
+void Complete(PendingFuture& pending) {
+  pending.api->CompleteWithResult(pending.handle, 0, pending.value);
+}
+
+// Completes, copies, releases and polls futures of a single API from all
+// threads at once.
+void TestConcurrentCompletion() {
+  firebase::ReferenceCountedFutureImpl api(1);
+  Pool pool;
+  CallbackCounter callbacks;
+  std::atomic<int> next_value{0};
+
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kThreadCount; thread++) {
+    threads.emplace_back([&, thread]() {
+      std::mt19937 random(thread);
+      for (int iteration = 0; iteration < g_iterations; iteration++) {
+        switch (random() % 5) {
+          case 0:
+          case 1: {
+            // Allocate, sometimes as the last result of the API.
+            int fn_idx = random() % 2 == 0 ? 0 : firebase::ReferenceCountedFutureImpl::kNoFunctionIndex;
+            PendingFuture pending{&api, api.SafeAlloc<int>(fn_idx), {}, next_value++};
+            pending.future = firebase::MakeFuture(&api, pending.handle);
+            pool.Add(std::move(pending));
+            break;
+          }
+          case 2: {
+            PendingFuture pending;
+            if (pool.Take(random, pending)) {
+              Complete(pending);
+            }
+            break;
+          }
+          case 3: {
+            PendingFuture pending;
+            if (pool.Take(random, pending)) {
+              callbacks.Add(pending.future, pending.value);
+              pool.Add(std::move(pending));
+            }
+            break;
+          }
+          default: {
+            firebase::Future<int> future;
+            if (pool.Copy(random, future)) {
+              future.status();
+              firebase::Future<int> copy = future;
+            }
+            break;
+          }
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  PendingFuture pending;
+  std::mt19937 random(0);
+  while (pool.Take(random, pending)) {
+    Complete(pending);
+  }
+  EXPECT_EQ(callbacks.run.load(), callbacks.added.load());
+  EXPECT_EQ(callbacks.wrong_results.load(), 0);
+  EXPECT(api.IsSafeToDelete());
+}
+
+// Releases the APIs of a FutureManager while other threads complete their
+// futures, run their callbacks and drop the last references to them, so
+// that orphans get reclaimed at any point.
+void TestOrphanedApis() {
+  CallbackCounter callbacks;
+  firebase::Future<int> survivor;
+  {
+    firebase::FutureManager manager;
+    Pool pool;
+    std::atomic<int> next_value{0};
+    std::atomic<int> owners_done{0};
+    // Releasing an owner from a callback of its own API, which mustn't
+    // delete the API under the running callback.
+    int callback_owner = 0;
+    manager.AllocFutureApi(&callback_owner, 1);
+    {
+      firebase::ReferenceCountedFutureImpl* api = manager.GetFutureApi(&callback_owner);
+      firebase::SafeFutureHandle<int> handle = api->SafeAlloc<int>(0);
+      firebase::Future<int> future = firebase::MakeFuture(api, handle);
+      future.OnCompletion([&manager, &callback_owner](const firebase::FutureBase&) {
+        manager.ReleaseFutureApi(&callback_owner);
+      });
+      api->CompleteWithResult(handle, 0, 0);
+      EXPECT(manager.GetFutureApi(&callback_owner) == nullptr);
+    }
+
+    std::vector<std::thread> threads;
+    // Owners allocate an API, hand out its futures, then release it while
+    // they're pending.
+    for (int thread = 0; thread < kThreadCount / 2; thread++) {
+      threads.emplace_back([&, thread]() {
+        std::mt19937 random(thread);
+        int owners[4];
+        for (int iteration = 0; iteration < g_iterations / 20; iteration++) {
+          int* owner = &owners[random() % 4];
+          if (manager.GetFutureApi(owner) == nullptr || random() % 4 == 0) {
+            // Replaces any API of this owner, orphaning it.
+            manager.AllocFutureApi(owner, 1);
+          }
+          firebase::ReferenceCountedFutureImpl* api = manager.GetFutureApi(owner);
+          for (int future = 0; future < 4; future++) {
+            PendingFuture pending{api, api->SafeAlloc<int>(future % 2 == 0 ? 0 : firebase::ReferenceCountedFutureImpl::kNoFunctionIndex), {}, next_value++};
+            pending.future = firebase::MakeFuture(api, pending.handle);
+            callbacks.Add(pending.future, pending.value);
+            pool.Add(std::move(pending));
+          }
+          if (random() % 2 == 0) {
+            manager.ReleaseFutureApi(owner);
+          }
+        }
+        for (int& owner : owners) {
+          manager.ReleaseFutureApi(&owner);
+        }
+        owners_done++;
+      });
+    }
+    // Completers complete the futures of orphaned and live APIs alike.
+    for (int thread = kThreadCount / 2; thread < kThreadCount; thread++) {
+      threads.emplace_back([&, thread]() {
+        std::mt19937 random(thread);
+        while (true) {
+          // Read first: once the owners are done, the pool only shrinks.
+          bool owners_running = owners_done < kThreadCount / 2;
+          PendingFuture pending;
+          if (pool.Take(random, pending)) {
+            Complete(pending);
+          } else if (owners_running) {
+            std::this_thread::yield();
+          } else {
+            break;
+          }
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    manager.CleanupOrphanedFutureApis();
+
+    // A future still referenced when its manager is destroyed is
+    // invalidated by the cleanup notifier.
+    int survivor_owner = 0;
+    manager.AllocFutureApi(&survivor_owner, 0);
+    firebase::ReferenceCountedFutureImpl* api = manager.GetFutureApi(&survivor_owner);
+    firebase::SafeFutureHandle<int> handle = api->SafeAlloc<int>();
+    survivor = firebase::MakeFuture(api, handle);
+    api->CompleteWithResult(handle, 0, 0);
+  }
+  EXPECT_EQ(survivor.status(), firebase::kFutureStatusInvalid);
+  EXPECT_EQ(callbacks.run.load(), callbacks.added.load());
+  EXPECT_EQ(callbacks.wrong_results.load(), 0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    g_iterations = std::atoi(argv[1]);
+  }
+  TestConcurrentCompletion();
+  TestOrphanedApis();
+  return TestExitCode();
+}
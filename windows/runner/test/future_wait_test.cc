@@ -0,0 +1,69 @@
+#include "future_wait.h"
+
+#include <chrono>
+#include <thread>
+
+#include "reference_counted_future_impl.h"
+#include "test.h"
+
+namespace {
+
+void TestReturnsOnceCompleted() {
+  firebase::ReferenceCountedFutureImpl api(0);
+  firebase::SafeFutureHandle<int> handle = api.SafeAlloc<int>();
+  firebase::Future<int> future = firebase::MakeFuture(&api, handle);
+  std::thread completer([&api, &handle]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    api.CompleteWithResult(handle, 0, 42);
+  });
+  EXPECT_EQ(WaitForFuture(future, std::chrono::seconds(10)), firebase::kFutureStatusComplete);
+  EXPECT_EQ(*future.result(), 42);
+  completer.join();
+}
+
+void TestTimesOut() {
+  firebase::ReferenceCountedFutureImpl api(0);
+  firebase::SafeFutureHandle<int> handle = api.SafeAlloc<int>();
+  firebase::Future<int> future = firebase::MakeFuture(&api, handle);
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(WaitForFuture(future, std::chrono::milliseconds(20)), firebase::kFutureStatusPending);
+  EXPECT(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+  // The callback of the wait was removed, or runs harmlessly.
+  api.CompleteWithResult(handle, 0, 42);
+  EXPECT_EQ(future.status(), firebase::kFutureStatusComplete);
+}
+
+void TestReturnsRightAwayWhenNotPending() {
+  firebase::ReferenceCountedFutureImpl api(0);
+  firebase::SafeFutureHandle<int> handle = api.SafeAlloc<int>();
+  firebase::Future<int> future = firebase::MakeFuture(&api, handle);
+  api.CompleteWithResult(handle, 0, 42);
+  EXPECT_EQ(WaitForFutureUntil(future, std::chrono::steady_clock::time_point()), firebase::kFutureStatusComplete);
+  EXPECT_EQ(WaitForFuture(firebase::Future<int>(), std::chrono::seconds(10)), firebase::kFutureStatusInvalid);
+}
+
+// Completes while waits time out, so that removing the callback races with
+// running it.
+void TestTimeoutRacingCompletion() {
+  firebase::ReferenceCountedFutureImpl api(0);
+  for (int iteration = 0; iteration < 200; iteration++) {
+    firebase::SafeFutureHandle<int> handle = api.SafeAlloc<int>();
+    firebase::Future<int> future = firebase::MakeFuture(&api, handle);
+    std::thread completer([&api, &handle]() {
+      api.CompleteWithResult(handle, 0, 0);
+    });
+    firebase::FutureStatus status = WaitForFuture(future, std::chrono::microseconds(iteration % 20));
+    EXPECT(status == firebase::kFutureStatusComplete || status == firebase::kFutureStatusPending);
+    completer.join();
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestReturnsOnceCompleted();
+  TestTimesOut();
+  TestReturnsRightAwayWhenNotPending();
+  TestTimeoutRacingCompletion();
+  return TestExitCode();
+}
@@ -0,0 +1,89 @@
+#include "jwt.h"
+
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+// Encodes |input| in base64url, with padding if |padded|.
+std::string EncodeBase64Url(const std::string& input, bool padded) {
+  static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  std::string output;
+  uint32_t buffer = 0;
+  int bits = 0;
+  for (unsigned char c : input) {
+    buffer = (buffer << 8) | c;
+    bits += 8;
+    while (bits >= 6) {
+      bits -= 6;
+      output.push_back(kAlphabet[(buffer >> bits) & 0x3F]);
+    }
+  }
+  if (bits > 0) {
+    output.push_back(kAlphabet[(buffer << (6 - bits)) & 0x3F]);
+  }
+  while (padded && output.size() % 4 != 0) {
+    output.push_back('=');
+  }
+  return output;
+}
+
+std::string MakeJwt(const std::string& payload, bool padded = false) {
+  return "eyJhbGciOiJSUzI1NiJ9." + EncodeBase64Url(payload, padded) + ".signature";
+}
+
+void TestReadsExpiry() {
+  EXPECT(GetJwtExpiry(MakeJwt("{\"iss\":\"x\",\"exp\":1700000000,\"iat\":1}")) == std::optional<int64_t>(1700000000));
+  EXPECT(GetJwtExpiry(MakeJwt("{ \"exp\" : 42 }")) == std::optional<int64_t>(42));
+  // A string value equal to "exp" isn't the key.
+  EXPECT(GetJwtExpiry(MakeJwt("{\"sub\":\"exp\",\"exp\":42}")) == std::optional<int64_t>(42));
+}
+
+void TestPadding() {
+  // Payload lengths leaving 0, 1 and 2 padding characters.
+  for (const char* payload : {"{\"exp\":42}", "{\"exp\":42 }", "{\"exp\":42  }"}) {
+    EXPECT(GetJwtExpiry(MakeJwt(payload, false)) == std::optional<int64_t>(42));
+    EXPECT(GetJwtExpiry(MakeJwt(payload, true)) == std::optional<int64_t>(42));
+  }
+  std::string payload = EncodeBase64Url("{\"exp\":42 }", false);
+  // Too much padding, or data after it.
+  EXPECT(!GetJwtExpiry("a." + payload + "===.b").has_value());
+  EXPECT(!GetJwtExpiry("a." + payload + "=A.b").has_value());
+  // A truncated quantum.
+  EXPECT(!GetJwtExpiry("a." + EncodeBase64Url("{\"exp\":4}", false) + "A.b").has_value());
+}
+
+void TestUrlSafeAlphabet() {
+  // '>' and '?' encode with '-' and '_' in base64url.
+  std::string payload = "{\"exp\":42,\"x\":\">>>???\"}";
+  std::string encoded = EncodeBase64Url(payload, false);
+  EXPECT(encoded.find_first_of("-_") != std::string::npos);
+  EXPECT(GetJwtExpiry("a." + encoded + ".b") == std::optional<int64_t>(42));
+}
+
+void TestMalformedTokens() {
+  EXPECT(!GetJwtExpiry("").has_value());
+  EXPECT(!GetJwtExpiry("no dots").has_value());
+  EXPECT(!GetJwtExpiry("header." + EncodeBase64Url("{\"exp\":42}", false)).has_value());
+  EXPECT(!GetJwtExpiry("a.!!!!.b").has_value());
+  EXPECT(!GetJwtExpiry(MakeJwt("")).has_value());
+  EXPECT(!GetJwtExpiry(MakeJwt("not json")).has_value());
+  EXPECT(!GetJwtExpiry(MakeJwt("{\"iat\":42}")).has_value());
+  EXPECT(!GetJwtExpiry(MakeJwt("{\"exp\":}")).has_value());
+  EXPECT(!GetJwtExpiry(MakeJwt("{\"exp\":-42}")).has_value());
+  EXPECT(!GetJwtExpiry(MakeJwt("{\"exp\":\"42\"}")).has_value());
+  EXPECT(!GetJwtExpiry(MakeJwt("{\"exp\"")).has_value());
+  // Would overflow.
+  EXPECT(!GetJwtExpiry(MakeJwt("{\"exp\":99999999999999999999}")).has_value());
+}
+
+}  // namespace
+
+int main() {
+  TestReadsExpiry();
+  TestPadding();
+  TestUrlSafeAlphabet();
+  TestMalformedTokens();
+  return TestExitCode();
+}
@@ -0,0 +1,188 @@
+#include "listener_registry.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+// A listener whose behavior is set by each test.
+struct Listener {
+  int calls = 0;
+  std::function<void()> on_call;
+
+  static void Call(void* context) {
+    Listener* listener = static_cast<Listener*>(context);
+    listener->calls++;
+    if (listener->on_call) {
+      listener->on_call();
+    }
+  }
+};
+
+void TestAddAndRemove() {
+  ListenerRegistry registry;
+  Listener first, second;
+  ListenerRegistry::Handle first_handle = registry.Add(Listener::Call, &first);
+  registry.Add(Listener::Call, &second);
+  // Adding a listener twice returns the same handle.
+  EXPECT_EQ(registry.Add(Listener::Call, &first), first_handle);
+  EXPECT_EQ(registry.size(), 2u);
+
+  registry.Notify();
+  EXPECT_EQ(first.calls, 1);
+  EXPECT_EQ(second.calls, 1);
+
+  EXPECT(registry.Remove(first_handle));
+  EXPECT(!registry.Remove(first_handle));
+  EXPECT(registry.Remove(Listener::Call, &second));
+  EXPECT(!registry.Remove(Listener::Call, &second));
+  EXPECT_EQ(registry.size(), 0u);
+
+  registry.Notify();
+  EXPECT_EQ(first.calls, 1);
+  EXPECT_EQ(second.calls, 1);
+}
+
+void TestStaleHandlesDontMatchReusedSlots() {
+  ListenerRegistry registry;
+  Listener first, second;
+  ListenerRegistry::Handle stale = registry.Add(Listener::Call, &first);
+  EXPECT(registry.Remove(stale));
+  ListenerRegistry::Handle handle = registry.Add(Listener::Call, &second);
+  EXPECT(handle != stale);
+  EXPECT(!registry.Remove(stale));
+  EXPECT_EQ(registry.size(), 1u);
+
+  registry.Notify();
+  EXPECT_EQ(second.calls, 1);
+}
+
+void TestListenerRemovesItself() {
+  ListenerRegistry registry;
+  Listener first, second;
+  ListenerRegistry::Handle first_handle = registry.Add(Listener::Call, &first);
+  registry.Add(Listener::Call, &second);
+  first.on_call = [&registry, first_handle]() {
+    EXPECT(registry.Remove(first_handle));
+  };
+
+  registry.Notify();
+  EXPECT_EQ(first.calls, 1);
+  EXPECT_EQ(second.calls, 1);
+
+  registry.Notify();
+  EXPECT_EQ(first.calls, 1);
+  EXPECT_EQ(second.calls, 2);
+}
+
+void TestRemovedListenersArentNotified() {
+  ListenerRegistry registry;
+  Listener first, second, third;
+  registry.Add(Listener::Call, &first);
+  registry.Add(Listener::Call, &second);
+  registry.Add(Listener::Call, &third);
+  first.on_call = [&registry, &second]() {
+    EXPECT(registry.Remove(Listener::Call, &second));
+  };
+
+  registry.Notify();
+  EXPECT_EQ(first.calls, 1);
+  EXPECT_EQ(second.calls, 0);
+  EXPECT_EQ(third.calls, 1);
+}
+
+void TestAddedListenersAreNotifiedNextTime() {
+  ListenerRegistry registry;
+  Listener first, second, third;
+  ListenerRegistry::Handle first_handle = registry.Add(Listener::Call, &first);
+  // |second| reuses the slot freed by |first|, before |third| gets a new one.
+  first.on_call = [&registry, &second, &third, first_handle]() {
+    registry.Remove(first_handle);
+    registry.Add(Listener::Call, &second);
+    registry.Add(Listener::Call, &third);
+  };
+
+  registry.Notify();
+  EXPECT_EQ(first.calls, 1);
+  EXPECT_EQ(second.calls, 0);
+  EXPECT_EQ(third.calls, 0);
+
+  registry.Notify();
+  EXPECT_EQ(first.calls, 1);
+  EXPECT_EQ(second.calls, 1);
+  EXPECT_EQ(third.calls, 1);
+}
+
+void TestNestedNotifications() {
+  ListenerRegistry registry;
+  Listener first, second;
+  registry.Add(Listener::Call, &first);
+  registry.Add(Listener::Call, &second);
+  first.on_call = [&registry, &first]() {
+    if (first.calls == 1) {
+      registry.Notify();
+    }
+  };
+
+  registry.Notify();
+  EXPECT_EQ(first.calls, 2);
+  EXPECT_EQ(second.calls, 2);
+}
+
+void TestRemoveWaitsForRunningListener() {
+  ListenerRegistry registry;
+  Listener listener;
+  std::atomic<bool> started{false};
+  std::atomic<bool> returned{false};
+  listener.on_call = [&started, &returned]() {
+    started = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    returned = true;
+  };
+  ListenerRegistry::Handle handle = registry.Add(Listener::Call, &listener);
+
+  std::thread notifier([&registry]() { registry.Notify(); });
+  while (!started) {
+    std::this_thread::yield();
+  }
+  EXPECT(registry.Remove(handle));
+  // The context can be deleted right after, as the listener has returned.
+  EXPECT(returned);
+  notifier.join();
+  EXPECT_EQ(listener.calls, 1);
+}
+
+void TestDispatcher() {
+  std::vector<std::function<void()>> notifications;
+  ListenerRegistry registry(
+      [&notifications](std::function<void()> notification) {
+        notifications.push_back(std::move(notification));
+      });
+  Listener listener;
+  registry.Add(Listener::Call, &listener);
+
+  registry.Notify();
+  EXPECT_EQ(listener.calls, 0);
+  EXPECT_EQ(notifications.size(), 1u);
+  notifications[0]();
+  EXPECT_EQ(listener.calls, 1);
+}
+
+}  // namespace
+
+int main() {
+  TestAddAndRemove();
+  TestStaleHandlesDontMatchReusedSlots();
+  TestListenerRemovesItself();
+  TestRemovedListenersArentNotified();
+  TestAddedListenersAreNotifiedNextTime();
+  TestNestedNotifications();
+  TestRemoveWaitsForRunningListener();
+  TestDispatcher();
+  return TestExitCode();
+}
@@ -0,0 +1,121 @@
+#include "metrics.h"
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "test.h"
+
+namespace {
+
+using metrics::Histogram;
+
+void TestSubBucketBoundaries() {
+  // Values below kSubBucketCount have a bucket of their own, then every power
+  // of two starts a new run of kSubBucketCount buckets.
+  EXPECT_EQ(Histogram::BucketIndex(0), 0);
+  EXPECT_EQ(Histogram::BucketIndex(7), 7);
+  EXPECT_EQ(Histogram::BucketIndex(8), 8);
+  EXPECT_EQ(Histogram::BucketIndex(15), 15);
+  EXPECT_EQ(Histogram::BucketIndex(16), 16);
+  EXPECT_EQ(Histogram::BucketIndex(17), 16);
+  EXPECT_EQ(Histogram::BucketIndex(18), 17);
+  EXPECT_EQ(Histogram::BucketLowerBound(7), 7u);
+  EXPECT_EQ(Histogram::BucketLowerBound(8), 8u);
+  EXPECT_EQ(Histogram::BucketLowerBound(15), 15u);
+  EXPECT_EQ(Histogram::BucketLowerBound(16), 16u);
+  EXPECT_EQ(Histogram::BucketLowerBound(17), 18u);
+}
+
+void TestLargestValue() {
+  EXPECT_EQ(Histogram::BucketIndex(std::numeric_limits<uint64_t>::max()), Histogram::kBucketCount - 1);
+  EXPECT_EQ(Histogram::BucketIndex(uint64_t{1} << 63), Histogram::kBucketCount - Histogram::kSubBucketCount);
+  EXPECT_EQ(Histogram::BucketLowerBound(Histogram::kBucketCount - 1), uint64_t{15} << 60);
+}
+
+// Checks that |value| falls between the lower bound of its bucket and the one
+// of the next bucket.
+void ExpectInBucket(uint64_t value) {
+  int index = Histogram::BucketIndex(value);
+  EXPECT(index >= 0 && index < Histogram::kBucketCount);
+  EXPECT(Histogram::BucketLowerBound(index) <= value);
+  if (index + 1 < Histogram::kBucketCount) {
+    EXPECT(value < Histogram::BucketLowerBound(index + 1));
+  }
+}
+
+void TestLowerBounds() {
+  for (uint64_t value = 0; value < 4096; value++) {
+    ExpectInBucket(value);
+  }
+  for (int bit = 1; bit < 64; bit++) {
+    uint64_t power = uint64_t{1} << bit;
+    ExpectInBucket(power - 1);
+    ExpectInBucket(power);
+    ExpectInBucket(power + 1);
+    ExpectInBucket(power | (power - 1));
+  }
+  for (int index = 1; index < Histogram::kBucketCount; index++) {
+    EXPECT(Histogram::BucketLowerBound(index - 1) < Histogram::BucketLowerBound(index));
+    EXPECT_EQ(Histogram::BucketIndex(Histogram::BucketLowerBound(index)), index);
+  }
+}
+
+void TestPercentiles() {
+  Histogram::Snapshot unset;
+  EXPECT_EQ(unset.Percentile(50), 0u);
+
+  Histogram empty;
+  EXPECT_EQ(empty.GetSnapshot().Percentile(0), 0u);
+  EXPECT_EQ(empty.GetSnapshot().Percentile(100), 0u);
+
+  // 100 falls in the [96, 104) bucket.
+  Histogram single;
+  for (int i = 0; i < 3; i++) {
+    single.Record(100);
+  }
+  Histogram::Snapshot snapshot = single.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 3u);
+  EXPECT_EQ(snapshot.sum, 300u);
+  for (double percentile : {0.0, 50.0, 99.0, 100.0}) {
+    EXPECT_EQ(snapshot.Percentile(percentile), 96u);
+  }
+
+  Histogram spread;
+  for (uint64_t value = 0; value < 8; value++) {
+    spread.Record(value);
+  }
+  spread.Record(std::numeric_limits<uint64_t>::max());
+  snapshot = spread.GetSnapshot();
+  EXPECT_EQ(snapshot.Percentile(0), 0u);
+  EXPECT_EQ(snapshot.Percentile(50), 4u);
+  EXPECT_EQ(snapshot.Percentile(100), Histogram::BucketLowerBound(Histogram::kBucketCount - 1));
+}
+
+void TestSnapshotJson() {
+  metrics::Registry& registry = metrics::Registry::Get();
+  registry.GetCounter("test.counter").Increment(3);
+  registry.GetCounter("test.\"quoted\"").Increment();
+  registry.GetGauge("test.gauge").Set(-2);
+  Histogram& histogram = registry.GetHistogram("test.histogram");
+  histogram.Record(5);
+  histogram.Record(100);
+  registry.GetHistogram("test.unused");
+  EXPECT_EQ(registry.SnapshotJson(),
+            std::string("{\"counters\":{\"test.\\\"quoted\\\"\":1,\"test.counter\":3},"
+                        "\"gauges\":{\"test.gauge\":-2},"
+                        "\"histograms\":{"
+                        "\"test.histogram\":{\"count\":2,\"sum\":105,\"p50\":5,\"p90\":5,\"p99\":5,\"buckets\":[[5,1],[96,1]]},"
+                        "\"test.unused\":{\"count\":0,\"sum\":0,\"p50\":0,\"p90\":0,\"p99\":0,\"buckets\":[]}}}"));
+}
+
+}  // namespace
+
+int main() {
+  TestSubBucketBoundaries();
+  TestLargestValue();
+  TestLowerBounds();
+  TestPercentiles();
+  TestSnapshotJson();
+  return TestExitCode();
+}
@@ -0,0 +1,42 @@
+#ifndef RUNNER_TEST_TEST_H_
+#define RUNNER_TEST_TEST_H_
+
+// Minimal assertions for the runner tests, so that they don't need a test
+// framework. A failed expectation is reported, and makes TestExitCode()
+// return a failure, but the test keeps running.
+
+#include <atomic>
+#include <iostream>
+
+inline std::atomic<int> g_test_failures{0};
+
+#define EXPECT(condition)                                                   \
+  do {                                                                      \
+    if (!(condition)) {                                                     \
+      g_test_failures++;                                                    \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": expected " #condition \
+                << std::endl;                                               \
+    }                                                                       \
+  } while (false)
+
+#define EXPECT_EQ(actual, expected)                                          \
+  do {                                                                       \
+    auto actual_value = (actual);                                            \
+    auto expected_value = (expected);                                        \
+    if (!(actual_value == expected_value)) {                                 \
+      g_test_failures++;                                                     \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": expected " #actual " == " \
+                << expected_value << ", got " << actual_value << std::endl;  \
+    }                                                                        \
+  } while (false)
+
+// Returns the exit code of the test: non-zero if an expectation failed.
+inline int TestExitCode() {
+  if (g_test_failures > 0) {
+    std::cerr << g_test_failures << " expectation(s) failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+#endif  // RUNNER_TEST_TEST_H_
@@ -0,0 +1,201 @@
+#include "token_cache.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// Records the fetches, which complete when the test says so.
+class FakeFetcher {
+ public:
+  struct Fetch {
+    bool force_refresh;
+    TokenCache::Callback callback;
+  };
+
+  TokenCache::Fetcher fetcher() {
+    return [this](bool force_refresh, TokenCache::Callback callback) {
+      fetches.push_back({force_refresh, std::move(callback)});
+    };
+  }
+
+  // Completes the fetch at |index| with |token|, valid for |time_to_live|.
+  void Complete(size_t index, const std::string& token, TokenCache::Clock::duration time_to_live = 1h) {
+    TokenCache::Result result;
+    result.token = token;
+    result.time_to_live = time_to_live;
+    CallBack(index, result);
+  }
+
+  void Fail(size_t index) {
+    TokenCache::Result result;
+    result.error = -1;
+    result.error_message = "Failed";
+    CallBack(index, result);
+  }
+
+  std::vector<Fetch> fetches;
+
+ private:
+  void CallBack(size_t index, const TokenCache::Result& result) {
+    // Moved out first, as the callback may start another fetch.
+    TokenCache::Callback callback = std::move(fetches[index].callback);
+    callback(result);
+  }
+};
+
+// Collects the results a caller got.
+struct Results {
+  TokenCache::Callback callback() {
+    return [this](const TokenCache::Result& result) {
+      tokens.push_back(result.error == 0 ? result.token : "error");
+    };
+  }
+
+  std::vector<std::string> tokens;
+};
+
+void TestServesCachedToken() {
+  FakeFetcher fetcher;
+  TokenCache cache(fetcher.fetcher(), 5min);
+  Results results;
+  cache.Get(results.callback());
+  EXPECT_EQ(fetcher.fetches.size(), 1u);
+  fetcher.Complete(0, "a");
+  cache.Get(results.callback());
+  EXPECT_EQ(fetcher.fetches.size(), 1u);
+  EXPECT(results.tokens == std::vector<std::string>({"a", "a"}));
+}
+
+void TestRefreshesWithinMargin() {
+  FakeFetcher fetcher;
+  TokenCache cache(fetcher.fetcher(), 5min);
+  Results results;
+  cache.Get(results.callback());
+  fetcher.Complete(0, "a", 1min);
+  // Still valid, so served, but refreshed in the background, once.
+  cache.Get(results.callback());
+  cache.Get(results.callback());
+  EXPECT(results.tokens == std::vector<std::string>({"a", "a", "a"}));
+  EXPECT_EQ(fetcher.fetches.size(), 2u);
+  EXPECT(!fetcher.fetches[1].force_refresh);
+  fetcher.Complete(1, "b");
+  cache.Get(results.callback());
+  EXPECT_EQ(results.tokens.back(), "b");
+  EXPECT_EQ(fetcher.fetches.size(), 2u);
+}
+
+void TestFetchesExpiredToken() {
+  FakeFetcher fetcher;
+  TokenCache cache(fetcher.fetcher(), 0min);
+  Results results;
+  cache.Get(results.callback());
+  fetcher.Complete(0, "a", 0s);
+  cache.Get(results.callback());
+  EXPECT_EQ(fetcher.fetches.size(), 2u);
+  EXPECT_EQ(results.tokens.size(), 1u);
+  fetcher.Complete(1, "b");
+  EXPECT(results.tokens == std::vector<std::string>({"a", "b"}));
+}
+
+void TestCoalescesFetches() {
+  FakeFetcher fetcher;
+  TokenCache cache(fetcher.fetcher(), 5min);
+  Results results;
+  cache.Get(results.callback());
+  cache.Get(results.callback());
+  cache.Get(results.callback());
+  EXPECT_EQ(fetcher.fetches.size(), 1u);
+  fetcher.Complete(0, "a");
+  EXPECT(results.tokens == std::vector<std::string>({"a", "a", "a"}));
+}
+
+void TestForcedRefreshDoesNotJoinUnforcedFetch() {
+  FakeFetcher fetcher;
+  TokenCache cache(fetcher.fetcher(), 5min);
+  Results unforced;
+  Results forced;
+  cache.Get(unforced.callback());
+  cache.Get(forced.callback(), true);
+  cache.Get(forced.callback(), true);
+  EXPECT_EQ(fetcher.fetches.size(), 1u);
+  fetcher.Complete(0, "a");
+  EXPECT(unforced.tokens == std::vector<std::string>({"a"}));
+  EXPECT(forced.tokens.empty());
+  // The forced callers share a forced fetch.
+  EXPECT_EQ(fetcher.fetches.size(), 2u);
+  EXPECT(fetcher.fetches[1].force_refresh);
+  fetcher.Complete(1, "b");
+  EXPECT(forced.tokens == std::vector<std::string>({"b", "b"}));
+}
+
+void TestForcedRefreshJoinsForcedFetch() {
+  FakeFetcher fetcher;
+  TokenCache cache(fetcher.fetcher(), 5min);
+  Results results;
+  cache.Get(results.callback(), true);
+  cache.Get(results.callback(), true);
+  cache.Get(results.callback());
+  EXPECT_EQ(fetcher.fetches.size(), 1u);
+  EXPECT(fetcher.fetches[0].force_refresh);
+  fetcher.Complete(0, "a");
+  EXPECT(results.tokens == std::vector<std::string>({"a", "a", "a"}));
+}
+
+void TestForcedRefreshBypassesCache() {
+  FakeFetcher fetcher;
+  TokenCache cache(fetcher.fetcher(), 5min);
+  Results results;
+  cache.Get(results.callback());
+  fetcher.Complete(0, "a");
+  cache.Get(results.callback(), true);
+  EXPECT_EQ(fetcher.fetches.size(), 2u);
+  EXPECT(fetcher.fetches[1].force_refresh);
+  fetcher.Complete(1, "b");
+  EXPECT(results.tokens == std::vector<std::string>({"a", "b"}));
+}
+
+void TestInvalidateRetriesFetchInFlight() {
+  FakeFetcher fetcher;
+  TokenCache cache(fetcher.fetcher(), 5min);
+  Results results;
+  cache.Get(results.callback());
+  cache.Invalidate();
+  fetcher.Complete(0, "stale");
+  EXPECT(results.tokens.empty());
+  EXPECT_EQ(fetcher.fetches.size(), 2u);
+  fetcher.Complete(1, "a");
+  EXPECT(results.tokens == std::vector<std::string>({"a"}));
+}
+
+void TestErrorsAreNotCached() {
+  FakeFetcher fetcher;
+  TokenCache cache(fetcher.fetcher(), 5min);
+  Results results;
+  cache.Get(results.callback());
+  fetcher.Fail(0);
+  cache.Get(results.callback());
+  EXPECT_EQ(fetcher.fetches.size(), 2u);
+  fetcher.Complete(1, "a");
+  EXPECT(results.tokens == std::vector<std::string>({"error", "a"}));
+}
+
+}  // namespace
+
+int main() {
+  TestServesCachedToken();
+  TestRefreshesWithinMargin();
+  TestFetchesExpiredToken();
+  TestCoalescesFetches();
+  TestForcedRefreshDoesNotJoinUnforcedFetch();
+  TestForcedRefreshJoinsForcedFetch();
+  TestForcedRefreshBypassesCache();
+  TestInvalidateRetriesFetchInFlight();
+  TestErrorsAreNotCached();
+  return TestExitCode();
+}
@@ -0,0 +1,95 @@
+#include "token_cache.h"
+
+#include <iterator>
+#include <utility>
+
+TokenCache::TokenCache(Fetcher fetcher, Clock::duration refresh_margin)
+  : fetcher_(std::move(fetcher)), refresh_margin_(refresh_margin) {}
+
+void TokenCache::Get(Callback callback, bool force_refresh) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  Clock::time_point now = Clock::now();
+  if (!force_refresh && token_.has_value() && now < expires_at_) {
+    Result result;
+    result.token = token_.value();
+    result.time_to_live = expires_at_ - now;
+    bool refresh = !fetching_ && expires_at_ - now < refresh_margin_;
+    if (refresh) {
+      fetching_ = true;
+      fetch_forced_ = false;
+    }
+    uint64_t generation = generation_;
+    lock.unlock();
+    callback(result);
+    if (refresh) {
+      Fetch(generation, false);
+    }
+    return;
+  }
+
+  if (fetching_) {
+    if (force_refresh && !fetch_forced_) {
+      waiting_forced_.push_back(std::move(callback));
+    } else {
+      waiting_.push_back(std::move(callback));
+    }
+    return;
+  }
+  waiting_.push_back(std::move(callback));
+  fetching_ = true;
+  fetch_forced_ = force_refresh;
+  uint64_t generation = generation_;
+  lock.unlock();
+  Fetch(generation, force_refresh);
+}
+
+void TokenCache::Invalidate() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  token_.reset();
+  generation_++;
+}
+
+void TokenCache::Fetch(uint64_t generation, bool force_refresh) {
+  fetcher_(force_refresh, [this, generation](const Result& result) {
+    OnFetched(generation, result);
+  });
+}
+
+void TokenCache::OnFetched(uint64_t generation, const Result& result) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (generation != generation_) {
+    // Invalidated meanwhile: the waiting callers need a new token, which
+    // satisfies forced refreshes too.
+    bool forced = fetch_forced_ || !waiting_forced_.empty();
+    waiting_.insert(waiting_.end(), std::make_move_iterator(waiting_forced_.begin()), std::make_move_iterator(waiting_forced_.end()));
+    waiting_forced_.clear();
+    if (waiting_.empty()) {
+      fetching_ = false;
+      return;
+    }
+    fetch_forced_ = forced;
+    uint64_t current_generation = generation_;
+    lock.unlock();
+    Fetch(current_generation, forced);
+    return;
+  }
+
+  if (result.error == 0) {
+    token_ = result.token;
+    expires_at_ = Clock::now() + result.time_to_live;
+  }
+  std::vector<Callback> waiting;
+  waiting.swap(waiting_);
+  // Callers which forced a refresh meanwhile get the next token.
+  bool fetch_forced = !waiting_forced_.empty();
+  waiting_.swap(waiting_forced_);
+  fetching_ = fetch_forced;
+  fetch_forced_ = fetch_forced;
+  lock.unlock();
+  for (const Callback& callback : waiting) {
+    callback(result);
+  }
+  if (fetch_forced) {
+    Fetch(generation, true);
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef RUNNER_TOKEN_CACHE_H_
+#define RUNNER_TOKEN_CACHE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Caches a token fetched asynchronously (eg. from Dart over a method channel)
+// until shortly before it expires. It doesn't depend on Flutter nor Firebase,
+// so that it can be used by any runner.
+//
+// - A token valid for longer than the refresh margin is served from the cache.
+// - A token valid for less than the margin is still served, but a new one is
+//   fetched in the background.
+// - Callers needing a new token share a single in-flight fetch.
+class TokenCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // A token, or the error which prevented getting one.
+  struct Result {
+    std::string token;
+    // How long the token stays valid, from the time it's reported.
+    Clock::duration time_to_live = Clock::duration::zero();
+    // Non-zero on failure.
+    int error = 0;
+    std::string error_message;
+  };
+
+  using Callback = std::function<void(const Result& result)>;
+  // Fetches a new token, calling back once (on any thread) when done.
+  // |force_refresh| is set when the caller asked for a fresh token.
+  using Fetcher = std::function<void(bool force_refresh, Callback callback)>;
+
+  TokenCache(Fetcher fetcher, Clock::duration refresh_margin);
+  TokenCache(TokenCache const&) = delete;
+  void operator=(TokenCache const&) = delete;
+
+  // Calls back with a token, from the cache unless |force_refresh| is set or
+  // the cached one expired. A forced refresh joins a forced fetch in flight,
+  // but a fetch that wasn't forced may return the token the caller wants
+  // replaced, so another fetch follows it. Callbacks may run on the calling
+  // thread.
+  void Get(Callback callback, bool force_refresh = false);
+
+  // Drops the cached token, eg. because it belongs to a signed out user.
+  // Fetches in flight are retried, so that their callers don't get a stale
+  // token either.
+  void Invalidate();
+
+ private:
+  // Starts a fetch. Must be called with |mutex_| unlocked, after having set
+  // |fetching_| and |fetch_forced_| under it.
+  void Fetch(uint64_t generation, bool force_refresh);
+
+  // Handles the result of the fetch started for |generation|.
+  void OnFetched(uint64_t generation, const Result& result);
+
+  Fetcher fetcher_;
+  Clock::duration refresh_margin_;
+
+  std::mutex mutex_;
+  std::optional<std::string> token_;
+  Clock::time_point expires_at_;
+  // Whether a fetch is in flight, and whether it was forced.
+  bool fetching_ = false;
+  bool fetch_forced_ = false;
+  // Incremented on invalidation, so that in-flight fetches are ignored.
+  uint64_t generation_ = 0;
+  // Callers waiting for the fetch in flight.
+  std::vector<Callback> waiting_;
+  // Callers forcing a refresh while a fetch that isn't forced is in flight,
+  // waiting for the forced fetch following it.
+  std::vector<Callback> waiting_forced_;
+};
+
+#endif  // RUNNER_TOKEN_CACHE_H_